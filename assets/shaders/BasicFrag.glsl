@@ -1,5 +1,10 @@
 #version 450
 
+// toggled per pipeline variant, disabled paths are removed when the 
+// pipeline is created
+layout(constant_id = 0) const bool c_Texturing = true;
+layout(constant_id = 1) const bool c_VertexColor = true;
+
 layout(location = 0) in vec3 i_Color;
 layout(location = 1) in vec2 i_TextureCoordinates;
 
@@ -7,8 +12,18 @@ layout(location = 0) out vec4 o_Color;
 
 layout(binding = 1) uniform sampler2D u_Sampler;
 
+layout(push_constant) uniform Draw {
+    vec4 Tint;
+} draw;
+
 
 void main() 
 {
-    o_Color = texture(u_Sampler, i_TextureCoordinates) * vec4(i_Color, 1.0);
+    o_Color = draw.Tint;
+
+    if (c_Texturing)
+        o_Color *= texture(u_Sampler, i_TextureCoordinates);
+
+    if (c_VertexColor)
+        o_Color *= vec4(i_Color, 1.0);
 }
@@ -0,0 +1,24 @@
+#version 450
+
+// one invocation per cube face, every face is a quad of 4 vertices
+// drawn as 2 triangles
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) writeonly buffer Indices {
+    uint Data[];
+} indices;
+
+layout(push_constant) uniform Generate {
+    uint FaceCount;
+} generate;
+
+void main()
+{
+    uint face = gl_GlobalInvocationID.x;
+    if (face >= generate.FaceCount)
+        return;
+
+    const uint corners[6] = uint[](0, 1, 2, 2, 3, 0);
+    for (uint i = 0; i < 6; i++)
+        indices.Data[face * 6 + i] = face * 4 + corners[i];
+}
@@ -51,6 +51,7 @@ includedirs({
 links({
 	"GLFW",
 	"%{VULKAN_SDK}/Lib/vulkan-1.lib",
+	"%{VULKAN_SDK}/Lib/shaderc_shared.lib",
 	"OptickCore",
 })
 
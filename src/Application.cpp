@@ -26,19 +26,30 @@ namespace LearningVulkan
 
         m_Window->SetResizeFn(std::bind_front(&Application::OnResize, this));
         glfwSetInputMode(m_Window->GetNativeWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        m_Extent = { m_Window->GetWidth(), m_Window->GetHeight() };
+        m_Camera = new Camera(m_Window->GetNativeWindow());
         SetupRenderer();
     }
 
     Application::~Application()
     {
+        // stopped first, it's the only user of the render context
+        delete m_RenderThread;
         delete m_RenderContext;
+        delete m_Camera;
 
         delete m_Window;
     }
 
     void Application::Run()
     {
-        float currentFrameTime = 0.0f, lastFrameTime = 0.0f;
+        // a long stall (e.g. dragging the window) would otherwise make us
+        // run hundreds of ticks to catch up, each making the next frame
+        // even longer
+        constexpr double MaxFrameTime = 0.25;
+
+        double currentFrameTime = 0.0, lastFrameTime = glfwGetTime();
+        double accumulator = 0.0;
         while (m_Window->IsOpen())
         {
             OPTICK_FRAME("MainThread");
@@ -46,18 +57,89 @@ namespace LearningVulkan
             m_DeltaTime = currentFrameTime - lastFrameTime;
             lastFrameTime = currentFrameTime;
 
-            if (!m_Minimized)
-                m_RenderContext->DrawFrame();
-
             m_Window->PollEvents();
+
+            // the simulation always advances in whole steps so its results
+            // don't depend on the frame rate
+            accumulator += std::min<double>(m_DeltaTime, MaxFrameTime);
+            while (accumulator >= m_FixedTimestep)
+            {
+                Tick(m_FixedTimestep);
+                accumulator -= m_FixedTimestep;
+            }
+
+            // render the part of the step that has passed since the last
+            // tick by blending it with the one before
+            float alpha = accumulator / m_FixedTimestep;
+            CameraState camera = m_Camera->GetInterpolatedState(alpha);
+            m_RenderThread->PublishCamera(camera);
+
+            if (m_Minimized)
+                continue;
+
+            // the render thread is working on the previous packet while
+            // this one is built, submitting waits for it to pick that up
+            FramePacket& packet = m_RenderThread->BeginPacket();
+            BuildFramePacket(packet, camera);
+            m_RenderThread->SubmitPacket();
         }
 
+        m_RenderThread->WaitIdle();
         m_RenderContext->GetLogicalDevice()->WaitIdle();
     }
 
+    void Application::SetLateInputLatching(bool enabled)
+    {
+        m_RenderThread->SetLateInputLatching(enabled);
+    }
+
+    void Application::SetFramePacing(FramePacingMode mode,
+                                     double targetFrameRate)
+    {
+        m_RenderThread->SetFramePacing(mode, targetFrameRate);
+    }
+
+    FramePacingMode Application::GetFramePacing() const
+    {
+        return m_RenderThread->GetFramePacing();
+    }
+
     void Application::SetupRenderer()
     {
         m_RenderContext = new RendererContext("Learning Vulkan");
+        // the renderer belongs to the render thread once that started
+        m_CubeCount = m_RenderContext->GetCubeCount();
+        m_RenderThread = new RenderThread(m_RenderContext, m_Extent);
+    }
+
+    void Application::Tick(float timestep)
+    {
+        OPTICK_EVENT();
+        m_Camera->Tick(timestep);
+    }
+
+    void Application::BuildFramePacket(FramePacket& packet,
+                                       const CameraState& camera) const
+    {
+        static const std::array CubeTints = {
+            glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+            glm::vec4(1.0f, 0.6f, 0.6f, 1.0f),
+        };
+
+        packet.Camera = camera;
+        packet.Extent = m_Extent;
+
+        // the packet is reused, clearing keeps the draw list's memory
+        packet.Draws.clear();
+        const std::vector<PipelineVariantKey>& cubeVariants =
+                                            RendererContext::GetCubeVariants();
+        for (uint32_t i = 0; i < m_CubeCount; i++)
+        {
+            DrawItem& draw = packet.Draws.emplace_back();
+            draw.Mesh = i;
+            draw.Variant = cubeVariants[i % cubeVariants.size()];
+            draw.Tint = CubeTints[i % CubeTints.size()];
+        }
     }
 
     void Application::OnResize(uint32_t width, uint32_t height)
@@ -68,7 +150,8 @@ namespace LearningVulkan
             return;
         }
 
+        // the render thread resizes once it gets a packet with the new size
         m_Minimized = false;
-        m_RenderContext->Resize(width, height);
+        m_Extent = { width, height };
     }
 }
@@ -2,6 +2,8 @@
 
 #include "Window.h"
 #include "RendererContext.h"
+#include "RenderThread.h"
+#include "Camera.h"
 
 #define VK_USE_PLATFORM_WIN32_KHR
 
@@ -20,16 +22,37 @@ namespace LearningVulkan
         const Window* GetWindow() const { return m_Window; }
         float GetDeltaTime() const { return  m_DeltaTime; }
 
+        // the simulation advances by this much every tick, independent of
+        // the frame rate
+        float GetFixedTimestep() const { return m_FixedTimestep; }
+        void SetFixedTimestep(float timestep) { m_FixedTimestep = timestep; }
+
+        // lets the render thread use the newest camera when submitting
+        // instead of the one its frame packet was built with
+        void SetLateInputLatching(bool enabled);
+        // applied by the render thread before its next frame
+        void SetFramePacing(FramePacingMode mode,
+                            double targetFrameRate = 60.0);
+        FramePacingMode GetFramePacing() const;
+
     private:
         void SetupRenderer();
         void OnResize(uint32_t width, uint32_t height);
+        void Tick(float timestep);
+        void BuildFramePacket(FramePacket& packet,
+                              const CameraState& camera) const;
         
     private:
         Window* m_Window;
         RendererContext* m_RenderContext;
+        RenderThread* m_RenderThread;
+        Camera* m_Camera;
         uint32_t m_FrameIndex = 0;
+        uint32_t m_CubeCount = 0;
+        VkExtent2D m_Extent;
         bool m_Minimized = false;
         float m_DeltaTime = 0.0f;
+        float m_FixedTimestep = 1.0f / 120.0f;
 
         static Application* m_Instance;
     };
@@ -0,0 +1,133 @@
+#include "Camera.h"
+
+#include <GLFW/glfw3.h>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // glfw callbacks can't carry state, the window's user pointer is
+        // already used for resizing
+        double s_ScrollOffset = 0.0;
+
+        void MouseScrollCallback(GLFWwindow* window, double x, double y)
+        {
+            s_ScrollOffset += y;
+        }
+    }
+
+    glm::mat4 CameraState::GetViewMatrix() const
+    {
+        return glm::lookAt(Position, Position + Front, Up);
+    }
+
+    glm::mat4 CameraState::GetProjectionMatrix(float aspectRatio) const
+    {
+        return glm::perspective(glm::radians(FieldOfView), aspectRatio,
+                                0.1f, 50.0f);
+    }
+
+    Camera::Camera(GLFWwindow* window)
+        : m_Window(window)
+    {
+        glfwSetScrollCallback(m_Window, MouseScrollCallback);
+        // the first tick blends from this one
+        m_State.SampleTime = std::chrono::steady_clock::now();
+    }
+
+    void Camera::Tick(float timestep)
+    {
+        m_PreviousState = m_State;
+
+        glm::vec3 velocity = {0.0f, 0.0f, 0.0f};
+
+        if (glfwGetKey(m_Window, GLFW_KEY_W))
+            velocity += m_State.Front;
+        else if (glfwGetKey(m_Window, GLFW_KEY_S))
+            velocity -= m_State.Front;
+
+        if (glfwGetKey(m_Window, GLFW_KEY_A))
+            velocity -= m_Right;
+        else if(glfwGetKey(m_Window, GLFW_KEY_D))
+            velocity += m_Right;
+
+        if(glfwGetKey(m_Window, GLFW_KEY_Q))
+            velocity -= m_State.Up;
+        else if (glfwGetKey(m_Window, GLFW_KEY_E))
+            velocity += m_State.Up;
+
+        if(velocity != glm::vec3(0.0f))
+            velocity = glm::normalize(velocity);
+
+        m_State.Position += velocity * timestep * 6.0f;
+        
+        double mouseX, mouseY;
+        glfwGetCursorPos(m_Window, &mouseX, &mouseY);
+
+        if(m_FirstUpdate)
+        {
+            m_LastMouseX = mouseX;
+            m_LastMouseY = mouseY;
+            m_FirstUpdate = false;
+        }
+
+        double xoffset = (mouseX - m_LastMouseX) * 0.1f;
+        double yoffset = (mouseY - m_LastMouseY) * 0.1f;
+        m_LastMouseX = mouseX;
+        m_LastMouseY = mouseY;
+
+        m_Pitch += yoffset;
+        m_Yaw += xoffset;
+
+        if (m_Pitch > 89.0f)
+            m_Pitch = 89.0f;
+        if (m_Pitch < -89.0f)
+            m_Pitch = -89.0f;
+
+        glm::vec3 direction = { 0.0f, 0.0f, 0.0f };
+        direction.x = glm::cos(glm::radians(m_Yaw)) * 
+                                            glm::cos(glm::radians(m_Pitch));
+        direction.y = glm::sin(glm::radians(m_Pitch));
+        direction.z = glm::sin(glm::radians(m_Yaw)) * 
+                                            glm::cos(glm::radians(m_Pitch));
+        m_State.Front = glm::normalize(direction);
+
+        if (glfwGetKey(m_Window, GLFW_KEY_R))
+        {
+            m_State.Position = { 0.0f, 0.0f, 4.0f };
+            // don't interpolate the teleport
+            m_PreviousState.Position = m_State.Position;
+        }
+
+        m_Right = glm::normalize(glm::cross(m_State.Front, 
+                                            {0.0f, 1.0f, 0.0f}));
+        m_State.Up = glm::normalize(glm::cross(m_Right, m_State.Front));
+
+        m_State.FieldOfView -= s_ScrollOffset;
+        s_ScrollOffset = 0.0;
+
+        m_State.SampleTime = std::chrono::steady_clock::now();
+    }
+
+    CameraState Camera::GetInterpolatedState(float alpha) const
+    {
+        CameraState state = m_State;
+        state.Position = glm::mix(m_PreviousState.Position, m_State.Position,
+                                  alpha);
+        state.Front = glm::normalize(glm::mix(m_PreviousState.Front,
+                                              m_State.Front, alpha));
+        state.Up = glm::normalize(glm::mix(m_PreviousState.Up, m_State.Up,
+                                           alpha));
+        state.FieldOfView = glm::mix(m_PreviousState.FieldOfView,
+                                     m_State.FieldOfView, alpha);
+        // what's rendered is partly the previous tick's input, the latency
+        // has to be measured from the same point
+        state.SampleTime = m_PreviousState.SampleTime +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                (m_State.SampleTime - m_PreviousState.SampleTime) * alpha);
+        return state;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+
+struct GLFWwindow;
+
+namespace LearningVulkan
+{
+    // Everything the renderer needs to know about the camera for a frame
+    struct CameraState
+    {
+        glm::vec3 Position = { 0.0f, 0.0f, 4.0f };
+        glm::vec3 Front = { 0.0f, 0.0f, -1.0f };
+        glm::vec3 Up = { 0.0f, 1.0f, 0.0f };
+        float FieldOfView = 45.0f;
+        // when the input this state is based on was polled
+        std::chrono::steady_clock::time_point SampleTime;
+
+        glm::mat4 GetViewMatrix() const;
+        glm::mat4 GetProjectionMatrix(float aspectRatio) const;
+    };
+
+    // Fly camera controlled with WASDQE, the mouse and the scroll wheel.
+    // It's advanced in fixed steps and keeps the state of the last two, so
+    // frames in between ticks can be interpolated
+    // NOTE: reads glfw input so it can only be used on the main thread
+    class Camera
+    {
+    public:
+        Camera(GLFWwindow* window);
+
+        void Tick(float timestep);
+        const CameraState& GetState() const { return m_State; }
+        // alpha is how far we are between the previous tick and the
+        // last one, in [0, 1]
+        CameraState GetInterpolatedState(float alpha) const;
+
+    private:
+        GLFWwindow* m_Window;
+        CameraState m_PreviousState;
+        CameraState m_State;
+
+        glm::vec3 m_Right = { 1.0f, 0.0f, 0.0f };
+        double m_Pitch = 0.0, m_Yaw = -90.0;
+        double m_LastMouseX = 0.0, m_LastMouseY = 0.0;
+        bool m_FirstUpdate = true;
+    };
+}
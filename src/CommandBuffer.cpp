@@ -1,13 +1,19 @@
 #include "CommandBuffer.h"
 
 #include "LogicalDevice.h"
+#include "PhysicalDevice.h"
 #include "RendererContext.h"
 
+#include <cassert>
+
 namespace LearningVulkan 
 {
     CommandBuffer::CommandBuffer(const VkCommandPool& commandPool, 
         VkCommandBuffer&& commandBuffer)
-        : m_CommandBuffer(commandBuffer), m_CommandPool(commandPool)
+        : m_CommandBuffer(commandBuffer), m_CommandPool(commandPool),
+        m_Dispatch(&RendererContext::GetDeviceDispatch()),
+        m_MaxPushConstantsSize(RendererContext::GetLogicalDevice()
+            ->GetPhysicalDevice()->GetProperties().limits.maxPushConstantsSize)
     {
     }
 
@@ -18,16 +24,10 @@ namespace LearningVulkan
         AllocateCommandBuffer(commandPool, commandBufferLevel);
     }*/
 
-    CommandBuffer::~CommandBuffer()
-    {
-        LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-        vkFreeCommandBuffers(logicalDevice->GetVulkanDevice(), m_CommandPool,
-            1, &m_CommandBuffer);
-    }
-
-
     CommandBuffer::CommandBuffer(CommandBuffer&& other) noexcept
-        : m_CommandBuffer(std::move(other.m_CommandBuffer)), m_CommandPool(other.m_CommandPool)
+        : m_CommandBuffer(std::move(other.m_CommandBuffer)), m_CommandPool(other.m_CommandPool),
+        m_Dispatch(other.m_Dispatch),
+        m_MaxPushConstantsSize(other.m_MaxPushConstantsSize)
     {
     }
 
@@ -35,6 +35,8 @@ namespace LearningVulkan
     {
         m_CommandBuffer = std::move(other.m_CommandBuffer);
         m_CommandPool = other.m_CommandPool;
+        m_Dispatch = other.m_Dispatch;
+        m_MaxPushConstantsSize = other.m_MaxPushConstantsSize;
         return *this;
     }
 
@@ -45,62 +47,81 @@ namespace LearningVulkan
         VkCommandBufferUsageFlags usageFlags = static_cast<VkCommandBufferUsageFlags>(commandBufferUsage);
         commandBufferBeginInfo.flags = usageFlags;
 
-        assert(vkBeginCommandBuffer(m_CommandBuffer, &commandBufferBeginInfo) == VK_SUCCESS);
+        assert(m_Dispatch->vkBeginCommandBuffer(m_CommandBuffer, &commandBufferBeginInfo) == VK_SUCCESS);
     }
 
     void CommandBuffer::End()
     {
-        assert(vkEndCommandBuffer(m_CommandBuffer) == VK_SUCCESS);
+        assert(m_Dispatch->vkEndCommandBuffer(m_CommandBuffer) == VK_SUCCESS);
     }
 
     void CommandBuffer::BeginRenderPass(const VkRenderPassBeginInfo& renderPass)
     {
-        vkCmdBeginRenderPass(m_CommandBuffer, &renderPass, VK_SUBPASS_CONTENTS_INLINE);
+        m_Dispatch->vkCmdBeginRenderPass(m_CommandBuffer, &renderPass, VK_SUBPASS_CONTENTS_INLINE);
     }
 
     void CommandBuffer::EndRenderPass()
     {
-        vkCmdEndRenderPass(m_CommandBuffer);
+        m_Dispatch->vkCmdEndRenderPass(m_CommandBuffer);
     }
 
-    void CommandBuffer::BindPipeline(const VkPipeline& pipeline)
+    void CommandBuffer::BindPipeline(const VkPipeline& pipeline, VkPipelineBindPoint bindPoint)
     {
-        vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        m_Dispatch->vkCmdBindPipeline(m_CommandBuffer, bindPoint, pipeline);
     }
 
     void CommandBuffer::BindVertexBuffer(const GPUBuffer* buffer)
     {
         VkBuffer vertexBuffer = buffer->GetVulkanBuffer();
         VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(m_CommandBuffer, 0, 1, &vertexBuffer, offsets);
+        m_Dispatch->vkCmdBindVertexBuffers(m_CommandBuffer, 0, 1, &vertexBuffer, offsets);
     }
 
     void CommandBuffer::BindIndexBuffer(const GPUBuffer* buffer)
     {
-        vkCmdBindIndexBuffer(m_CommandBuffer, buffer->GetVulkanBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        m_Dispatch->vkCmdBindIndexBuffer(m_CommandBuffer, buffer->GetVulkanBuffer(), 0, VK_INDEX_TYPE_UINT32);
     }
 
     void CommandBuffer::SetScissor(const VkRect2D& scissorState)
     {
-        vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissorState);
+        m_Dispatch->vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissorState);
     }
 
     void CommandBuffer::SetViewport(const VkViewport& viewport)
     {
-        vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+        m_Dispatch->vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
     }
 
-    void CommandBuffer::BindDescriptorSets(const VkPipelineLayout& pipelineLayout, const VkDescriptorSet& descriptorSet)
+    void CommandBuffer::BindDescriptorSets(const VkPipelineLayout& pipelineLayout, const VkDescriptorSet& descriptorSet,
+        VkPipelineBindPoint bindPoint)
     {
-        vkCmdBindDescriptorSets(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
+        m_Dispatch->vkCmdBindDescriptorSets(m_CommandBuffer, bindPoint, 
             pipelineLayout, 0, 1, &descriptorSet, 
             0, nullptr);
     }
 
+    void CommandBuffer::PushConstants(VkPipelineLayout pipelineLayout,
+        const ShaderReflection& reflection, uint32_t offset, uint32_t size,
+        const void* data)
+    {
+        assert(offset % 4 == 0);
+        assert(offset + size <= m_MaxPushConstantsSize);
+        // has to fit the shader's block, not just the device
+        assert(offset + size <= reflection.PushConstantSize);
+
+        m_Dispatch->vkCmdPushConstants(m_CommandBuffer, pipelineLayout,
+                           reflection.PushConstantStages, offset, size, data);
+    }
+
     void CommandBuffer::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
         int32_t vertexOffset, uint32_t firstInstance)
     {
-        vkCmdDrawIndexed(m_CommandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+        m_Dispatch->vkCmdDrawIndexed(m_CommandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+    }
+
+    void CommandBuffer::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+    {
+        m_Dispatch->vkCmdDispatch(m_CommandBuffer, groupCountX, groupCountY, groupCountZ);
     }
 
     const VkCommandBuffer& CommandBuffer::GetVulkanCommandBuffer() const
@@ -169,7 +190,7 @@ namespace LearningVulkan
             assert(false);
         }
 
-        vkCmdPipelineBarrier(m_CommandBuffer, srcStageFlags, dstStageFlags,
+        m_Dispatch->vkCmdPipelineBarrier(m_CommandBuffer, srcStageFlags, dstStageFlags,
             0, 0, nullptr,
             0, nullptr, 1, &memoryBarrier);
         //RendererContext::EndCommandBuffer(m_CommandBuffer);
@@ -213,7 +234,7 @@ namespace LearningVulkan
         bufferImageCopy.imageOffset = { 0, 0, 0 };
         bufferImageCopy.imageExtent = { width, height, 1 };
 
-        vkCmdCopyBufferToImage(m_CommandBuffer, source->GetVulkanBuffer(),
+        m_Dispatch->vkCmdCopyBufferToImage(m_CommandBuffer, source->GetVulkanBuffer(),
             destination->GetVulkanImage(), destination->GetCurrentVulkanLayout(),
             1, &bufferImageCopy);
     }
@@ -224,10 +245,129 @@ namespace LearningVulkan
         bufferCopy.dstOffset = 0;
         bufferCopy.size = size;
         bufferCopy.srcOffset = 0;
-        vkCmdCopyBuffer(m_CommandBuffer, source->GetVulkanBuffer(), 
+        m_Dispatch->vkCmdCopyBuffer(m_CommandBuffer, source->GetVulkanBuffer(), 
             destination->GetVulkanBuffer(), 1, &bufferCopy);
     }
 
+    void CommandBuffer::ReleaseOwnership(GPUBuffer* buffer, QueueType source, QueueType destination,
+        const ResourceAccess& lastUse)
+    {
+        LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
+        uint32_t srcQueueFamily = logicalDevice->GetQueueFamily(source);
+        uint32_t dstQueueFamily = logicalDevice->GetQueueFamily(destination);
+
+        buffer->m_PendingTransfer.reset();
+        if (buffer->m_Concurrent || srcQueueFamily == dstQueueFamily)
+            return;
+
+        PendingOwnershipTransfer transfer;
+        transfer.SrcQueueFamily = srcQueueFamily;
+        transfer.DstQueueFamily = dstQueueFamily;
+
+        // the release only makes the writes available, the access of the
+        // destination is ignored
+        OwnershipBarrier(buffer->m_Buffer, VK_NULL_HANDLE, 0, transfer, 
+            lastUse.Stages, lastUse.Access, 
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        buffer->m_PendingTransfer = transfer;
+    }
+
+    void CommandBuffer::AcquireOwnership(GPUBuffer* buffer, const ResourceAccess& firstUse)
+    {
+        if (!buffer->m_PendingTransfer.has_value())
+            return;
+
+        // chained to the semaphore wait through the first use's stages
+        OwnershipBarrier(buffer->m_Buffer, VK_NULL_HANDLE, 0, 
+            *buffer->m_PendingTransfer, firstUse.Stages, 0, 
+            firstUse.Stages, firstUse.Access);
+        buffer->m_PendingTransfer.reset();
+    }
+
+    void CommandBuffer::ReleaseOwnership(Image* image, QueueType source, QueueType destination,
+        const ResourceAccess& lastUse, VkImageLayout newLayout)
+    {
+        LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
+        uint32_t srcQueueFamily = logicalDevice->GetQueueFamily(source);
+        uint32_t dstQueueFamily = logicalDevice->GetQueueFamily(destination);
+
+        PendingOwnershipTransfer transfer;
+        transfer.OldLayout = image->m_CurrentLayout;
+        transfer.NewLayout = newLayout;
+
+        image->m_PendingTransfer.reset();
+        image->m_CurrentLayout = newLayout;
+
+        if (!image->m_Concurrent && srcQueueFamily != dstQueueFamily)
+        {
+            // the layout transition happens between the release and the 
+            // acquire, both have to specify it
+            transfer.SrcQueueFamily = srcQueueFamily;
+            transfer.DstQueueFamily = dstQueueFamily;
+            OwnershipBarrier(VK_NULL_HANDLE, image->m_Image, 
+                image->m_AspectFlags, transfer, lastUse.Stages, 
+                lastUse.Access, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        }
+        else if (transfer.OldLayout == transfer.NewLayout)
+        {
+            return;
+        }
+
+        // without a family change the acquire only transitions the layout
+        image->m_PendingTransfer = transfer;
+    }
+
+    void CommandBuffer::AcquireOwnership(Image* image, const ResourceAccess& firstUse)
+    {
+        if (!image->m_PendingTransfer.has_value())
+            return;
+
+        OwnershipBarrier(VK_NULL_HANDLE, image->m_Image, image->m_AspectFlags,
+            *image->m_PendingTransfer, firstUse.Stages, 0, 
+            firstUse.Stages, firstUse.Access);
+        image->m_PendingTransfer.reset();
+    }
+
+    void CommandBuffer::OwnershipBarrier(VkBuffer buffer, VkImage image, VkImageAspectFlags aspect,
+        const PendingOwnershipTransfer& transfer, VkPipelineStageFlags srcStages,
+        VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        if (buffer != VK_NULL_HANDLE)
+        {
+            VkBufferMemoryBarrier memoryBarrier{};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            memoryBarrier.buffer = buffer;
+            memoryBarrier.offset = 0;
+            memoryBarrier.size = VK_WHOLE_SIZE;
+            memoryBarrier.srcQueueFamilyIndex = transfer.SrcQueueFamily;
+            memoryBarrier.dstQueueFamilyIndex = transfer.DstQueueFamily;
+            memoryBarrier.srcAccessMask = srcAccess;
+            memoryBarrier.dstAccessMask = dstAccess;
+
+            m_Dispatch->vkCmdPipelineBarrier(m_CommandBuffer, srcStages, dstStages, 0, 
+                0, nullptr, 1, &memoryBarrier, 0, nullptr);
+            return;
+        }
+
+        VkImageMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        memoryBarrier.image = image;
+        memoryBarrier.oldLayout = transfer.OldLayout;
+        memoryBarrier.newLayout = transfer.NewLayout;
+        memoryBarrier.srcQueueFamilyIndex = transfer.SrcQueueFamily;
+        memoryBarrier.dstQueueFamilyIndex = transfer.DstQueueFamily;
+        memoryBarrier.srcAccessMask = srcAccess;
+        memoryBarrier.dstAccessMask = dstAccess;
+        memoryBarrier.subresourceRange.baseArrayLayer = 0;
+        memoryBarrier.subresourceRange.baseMipLevel = 0;
+        memoryBarrier.subresourceRange.layerCount = 1;
+        memoryBarrier.subresourceRange.levelCount = 1;
+        memoryBarrier.subresourceRange.aspectMask = aspect;
+
+        m_Dispatch->vkCmdPipelineBarrier(m_CommandBuffer, srcStages, dstStages, 0, 
+            0, nullptr, 0, nullptr, 1, &memoryBarrier);
+    }
+
     /*void CommandBuffer::AllocateCommandBuffer(VkCommandPool commandPool, 
         VkCommandBufferLevel commandBufferLevel)
     {
@@ -3,6 +3,12 @@
 
 #include "GPUBuffer.h"
 #include "Image.h"
+#include "QueueOwnership.h"
+#include "ShaderReflection.h"
+#include "VulkanFunctions.h"
+
+#include <cstdint>
+#include <type_traits>
 
 namespace LearningVulkan
 {
@@ -12,14 +18,19 @@ namespace LearningVulkan
         OneTimeSubmit = 1,
     };
 
+    // the push constant space every vulkan implementation has to support
+    constexpr uint32_t MinMaxPushConstantsSize = 128;
+
+
     class CommandBuffer
     {
     public:
-        // NOTE: transfers ownership to this class
+        // NOTE: the buffer stays owned by the pool, it's freed when the pool
+        // is destroyed
         CommandBuffer(const VkCommandPool& commandPool, VkCommandBuffer&& commandBuffer);
 
         //CommandBuffer(const VkCommandPool& commandPool, VkCommandBufferLevel commandBufferLevel);
-        ~CommandBuffer();
+        ~CommandBuffer() = default;
         CommandBuffer(const CommandBuffer& other) = delete;
         CommandBuffer(CommandBuffer&& other) noexcept;
 
@@ -31,7 +42,8 @@ namespace LearningVulkan
         void BeginRenderPass(const VkRenderPassBeginInfo& renderPass);
         void EndRenderPass();
 
-        void BindPipeline(const VkPipeline& pipeline);
+        void BindPipeline(const VkPipeline& pipeline, 
+            VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
         // TODO: bind vertex buffers
         void BindVertexBuffer(const GPUBuffer* buffer);
         void BindIndexBuffer(const GPUBuffer* buffer);
@@ -39,9 +51,31 @@ namespace LearningVulkan
         void SetScissor(const VkRect2D& scissorState);
         void SetViewport(const VkViewport& viewport);
 
-        void BindDescriptorSets(const VkPipelineLayout& pipelineLayout, const VkDescriptorSet&);
+        void BindDescriptorSets(const VkPipelineLayout& pipelineLayout, const VkDescriptorSet&,
+            VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+        // pushed to the stages of the pipeline's push constant block
+        // NOTE: the size is also checked against the block and the device's 
+        // maxPushConstantsSize when recording
+        template<typename T>
+        void PushConstants(VkPipelineLayout pipelineLayout,
+                           const ShaderReflection& reflection, const T& data,
+                           uint32_t offset = 0)
+        {
+            static_assert(std::is_trivially_copyable_v<T>,
+                          "push constants are copied as raw bytes");
+            static_assert(sizeof(T) % 4 == 0,
+                          "push constant sizes must be a multiple of 4");
+            static_assert(sizeof(T) <= MinMaxPushConstantsSize,
+                          "push constants larger than 128 bytes aren't "
+                          "supported by every device");
+
+            PushConstants(pipelineLayout, reflection, offset, sizeof(T),
+                          &data);
+        }
 
         void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+        void Dispatch(uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
 
         const VkCommandBuffer& GetVulkanCommandBuffer() const;
 
@@ -49,12 +83,36 @@ namespace LearningVulkan
         void CopyBufferToImage(GPUBuffer* source, Image* destination, uint32_t width, uint32_t height);
         void CopyBuffer(const GPUBuffer* source, const GPUBuffer* destination, size_t size);
 
+        // Moves an exclusive resource to the family of another queue. The
+        // release is recorded on the source queue after the last use, the
+        // acquire on the destination queue before the first use, in a submit
+        // that waits for the release's submit at the first use's stages.
+        // NOTE: nothing is recorded for concurrent resources or when both 
+        // queues share a family, images still get their layout transition
+        void ReleaseOwnership(GPUBuffer* buffer, QueueType source, QueueType destination,
+            const ResourceAccess& lastUse);
+        void AcquireOwnership(GPUBuffer* buffer, const ResourceAccess& firstUse);
+        // the image is in the new layout once acquired
+        void ReleaseOwnership(Image* image, QueueType source, QueueType destination,
+            const ResourceAccess& lastUse, VkImageLayout newLayout);
+        void AcquireOwnership(Image* image, const ResourceAccess& firstUse);
+
     private:
+        // a buffer barrier if the buffer is set, otherwise an image barrier
+        void OwnershipBarrier(VkBuffer buffer, VkImage image, VkImageAspectFlags aspect,
+            const PendingOwnershipTransfer& transfer, VkPipelineStageFlags srcStages,
+            VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+        void PushConstants(VkPipelineLayout pipelineLayout,
+                           const ShaderReflection& reflection,
+                           uint32_t offset, uint32_t size, const void* data);
         //void AllocateCommandBuffer(VkCommandPool commandPool, VkCommandBufferLevel commandBufferLevel);
 
     private:
         VkCommandBuffer m_CommandBuffer;
         VkCommandPool m_CommandPool;
+        // cached so recording doesn't go through the renderer context
+        const DeviceDispatch* m_Dispatch;
+        uint32_t m_MaxPushConstantsSize;
 
         friend class RendererContext;
     };
@@ -0,0 +1,137 @@
+#include "CommandBufferAllocator.h"
+#include "LogicalDevice.h"
+
+#include <cassert>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    CommandBufferAllocator::CommandBufferAllocator(
+        LogicalDevice* logicalDevice, uint32_t frameSlotCount)
+        : m_LogicalDevice(logicalDevice), m_Slots(frameSlotCount + 1),
+        m_ImmediateSlot(frameSlotCount)
+    {
+    }
+
+    CommandBufferAllocator::~CommandBufferAllocator()
+    {
+        // destroying a pool frees its command buffers
+        const DeviceDispatch& dispatch = m_LogicalDevice->GetDispatch();
+        for (ThreadPools& slot : m_Slots)
+            for (auto& [thread, pools] : slot)
+                for (Pool& pool : *pools)
+                    if (pool.CommandPool != VK_NULL_HANDLE)
+                        dispatch.vkDestroyCommandPool(
+                            m_LogicalDevice->GetVulkanDevice(),
+                            pool.CommandPool, nullptr);
+    }
+
+    CommandBuffer* CommandBufferAllocator::Allocate(uint32_t frameSlot,
+                                                    QueueType queue)
+    {
+        assert(frameSlot < m_ImmediateSlot);
+        // the slot is reset once the graphics timeline passed its frame,
+        // that says nothing about work on other queues
+        assert(queue == QueueType::Graphics);
+        QueuePools& pools = GetThreadPools(frameSlot);
+        return Allocate(pools.at(static_cast<size_t>(queue)), queue);
+    }
+
+    void CommandBufferAllocator::ResetFrameSlot(uint32_t frameSlot)
+    {
+        OPTICK_EVENT();
+        assert(frameSlot < m_ImmediateSlot);
+
+        std::scoped_lock lock(m_Mutex);
+        ThreadPools& slot = m_Slots.at(frameSlot);
+        // a pool can't be reset while another thread records from it
+        assert(slot.size() <= 1);
+        for (auto& [thread, pools] : slot)
+        {
+            assert(thread == std::this_thread::get_id());
+            Reset(*pools);
+        }
+    }
+
+    CommandBuffer* CommandBufferAllocator::AllocateImmediate(QueueType queue)
+    {
+        QueuePools& pools = GetThreadPools(m_ImmediateSlot);
+        return Allocate(pools.at(static_cast<size_t>(queue)), queue);
+    }
+
+    void CommandBufferAllocator::ResetImmediate()
+    {
+        Reset(GetThreadPools(m_ImmediateSlot));
+    }
+
+    CommandBufferAllocator::QueuePools&
+        CommandBufferAllocator::GetThreadPools(uint32_t slot)
+    {
+        std::scoped_lock lock(m_Mutex);
+        std::unique_ptr<QueuePools>& pools =
+            m_Slots.at(slot)[std::this_thread::get_id()];
+        if (!pools)
+            pools = std::make_unique<QueuePools>();
+        return *pools;
+    }
+
+    CommandBuffer* CommandBufferAllocator::Allocate(Pool& pool,
+                                                    QueueType queue)
+    {
+        if (pool.NextFree < pool.CommandBuffers.size())
+            return pool.CommandBuffers.at(pool.NextFree++).get();
+
+        VkDevice device = m_LogicalDevice->GetVulkanDevice();
+        const DeviceDispatch& dispatch = m_LogicalDevice->GetDispatch();
+
+        if (pool.CommandPool == VK_NULL_HANDLE)
+        {
+            // no reset bit, the buffers are only ever reset with the pool
+            VkCommandPoolCreateInfo commandPoolCreateInfo{};
+            commandPoolCreateInfo.sType =
+                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            commandPoolCreateInfo.queueFamilyIndex =
+                m_LogicalDevice->GetQueueFamily(queue);
+
+            assert(dispatch.vkCreateCommandPool(device, &commandPoolCreateInfo,
+                                                nullptr, &pool.CommandPool)
+                   == VK_SUCCESS);
+        }
+
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+        commandBufferAllocateInfo.sType =
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+        commandBufferAllocateInfo.commandPool = pool.CommandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+        VkCommandBuffer vulkanCommandBuffer;
+        assert(dispatch.vkAllocateCommandBuffers(device,
+                                                 &commandBufferAllocateInfo,
+                                                 &vulkanCommandBuffer)
+               == VK_SUCCESS);
+
+        pool.CommandBuffers.push_back(std::make_unique<CommandBuffer>(
+            pool.CommandPool, std::move(vulkanCommandBuffer)));
+        pool.NextFree++;
+        return pool.CommandBuffers.back().get();
+    }
+
+    void CommandBufferAllocator::Reset(QueuePools& pools)
+    {
+        const DeviceDispatch& dispatch = m_LogicalDevice->GetDispatch();
+        for (Pool& pool : pools)
+        {
+            // untouched since the last reset
+            if (pool.NextFree == 0)
+                continue;
+
+            assert(dispatch.vkResetCommandPool(
+                       m_LogicalDevice->GetVulkanDevice(),
+                       pool.CommandPool, 0) == VK_SUCCESS);
+            pool.NextFree = 0;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CommandBuffer.h"
+#include "QueueOwnership.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace LearningVulkan
+{
+    class LogicalDevice;
+
+    // Hands out primary command buffers from pools owned per slot, thread
+    // and queue. Buffers are never freed or reset one by one, a slot's
+    // pools are reset as a whole and their buffers handed out again.
+    // Frames in flight use one slot each and only record graphics work on
+    // the thread that resets them, work that is waited on right after
+    // submitting uses the immediate slot of the recording thread
+    class CommandBufferAllocator
+    {
+    public:
+        CommandBufferAllocator(LogicalDevice* logicalDevice,
+                               uint32_t frameSlotCount);
+        ~CommandBufferAllocator();
+
+        CommandBufferAllocator(const CommandBufferAllocator& other) = delete;
+        CommandBufferAllocator& operator=(
+            const CommandBufferAllocator& other) = delete;
+
+        // valid until the slot is reset, graphics only and recorded by the
+        // thread that resets the slot
+        CommandBuffer* Allocate(uint32_t frameSlot, QueueType queue);
+        // the graphics queue has to be done with everything recorded for
+        // the slot
+        void ResetFrameSlot(uint32_t frameSlot);
+
+        // valid until the calling thread resets its immediate slot
+        CommandBuffer* AllocateImmediate(QueueType queue);
+        // the calling thread has to have waited for its immediate work
+        void ResetImmediate();
+
+    private:
+        struct Pool
+        {
+            VkCommandPool CommandPool = VK_NULL_HANDLE;
+            std::vector<std::unique_ptr<CommandBuffer>> CommandBuffers;
+            // the buffers before this one were handed out since the reset
+            size_t NextFree = 0;
+        };
+
+        using QueuePools =
+            std::array<Pool, static_cast<size_t>(QueueType::Count)>;
+        using ThreadPools =
+            std::unordered_map<std::thread::id, std::unique_ptr<QueuePools>>;
+
+        QueuePools& GetThreadPools(uint32_t slot);
+        CommandBuffer* Allocate(Pool& pool, QueueType queue);
+        void Reset(QueuePools& pools);
+
+    private:
+        LogicalDevice* m_LogicalDevice;
+        // the frame slots followed by the immediate slot
+        std::vector<ThreadPools> m_Slots;
+        uint32_t m_ImmediateSlot;
+        // only guards the thread lookup, a thread's pools are only used
+        // by that thread
+        std::mutex m_Mutex;
+    };
+}
@@ -0,0 +1,113 @@
+#include "ComputePipeline.h"
+
+#include "LayoutCache.h"
+#include "LogicalDevice.h"
+#include "RendererContext.h"
+#include "ShaderCompiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    ComputePipeline::ComputePipeline(
+        const ComputePipelineCreateInfo& createInfo)
+        : m_CreateInfo(createInfo)
+    {
+        std::vector<uint32_t> code = RendererContext::GetShaderCompiler()
+                    ->Compile(m_CreateInfo.ShaderPath, ShaderStage::Compute);
+
+        // there is nothing to fall back to on the first build
+        assert(!code.empty());
+
+        m_Reflection = ShaderReflection::Reflect(code, 
+                                                 VK_SHADER_STAGE_COMPUTE_BIT);
+        m_Layout = RendererContext::GetLayoutCache()->GetPipelineLayout(
+                                                m_Reflection, m_SetLayouts);
+        m_Dependencies = ShaderCompiler::GetDependencies(
+                                                    m_CreateInfo.ShaderPath);
+        m_Pipeline = Create(code);
+    }
+
+    ComputePipeline::~ComputePipeline()
+    {
+        // the pipeline can still be used by frames in flight
+        RendererContext::GetDeletionQueue()->PushPipeline(m_Pipeline);
+    }
+
+    bool ComputePipeline::UsesShader(
+        const std::filesystem::path& shaderPath) const
+    {
+        return std::find(m_Dependencies.begin(), m_Dependencies.end(),
+                         shaderPath.lexically_normal()) != m_Dependencies.end();
+    }
+
+    bool ComputePipeline::Rebuild()
+    {
+        std::vector<uint32_t> code = RendererContext::GetShaderCompiler()
+                    ->Compile(m_CreateInfo.ShaderPath, ShaderStage::Compute);
+
+        // the include graph may have changed even if compilation failed
+        m_Dependencies = ShaderCompiler::GetDependencies(
+                                                    m_CreateInfo.ShaderPath);
+
+        if (code.empty())
+            return false;
+
+        ShaderReflection reflection = ShaderReflection::Reflect(code, 
+                                                VK_SHADER_STAGE_COMPUTE_BIT);
+
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        if (RendererContext::GetLayoutCache()->GetPipelineLayout(
+                reflection, setLayouts) != m_Layout)
+        {
+            std::cerr << "Shader resources of " << m_CreateInfo.ShaderPath 
+                      << " changed, restart to apply\n";
+            return false;
+        }
+
+        RendererContext::GetDeletionQueue()->PushPipeline(m_Pipeline);
+        m_Pipeline = Create(code);
+        m_Reflection = std::move(reflection);
+        return true;
+    }
+
+    VkPipeline ComputePipeline::Create(const std::vector<uint32_t>& code) const
+    {
+        OPTICK_EVENT();
+        OPTICK_TAG("Name", m_CreateInfo.Name.c_str());
+
+        VkDevice device = RendererContext::GetLogicalDevice()->GetVulkanDevice();
+
+        VkShaderModuleCreateInfo shaderModuleCreateInfo{};
+        shaderModuleCreateInfo.sType = 
+                                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);
+        shaderModuleCreateInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        assert(RendererContext::GetDeviceDispatch().vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr,
+                                    &shaderModule) == VK_SUCCESS);
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = 
+                            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.stage.sType = 
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computePipelineCreateInfo.stage.module = shaderModule;
+        computePipelineCreateInfo.stage.pName = "main";
+        computePipelineCreateInfo.layout = m_Layout;
+
+        VkPipeline pipeline;
+        assert(RendererContext::GetDeviceDispatch().vkCreateComputePipelines(device, m_CreateInfo.PipelineCache,
+                                        1, &computePipelineCreateInfo,
+                                        nullptr, &pipeline) == VK_SUCCESS);
+
+        RendererContext::GetDeviceDispatch().vkDestroyShaderModule(device, shaderModule, nullptr);
+        return pipeline;
+    }
+}
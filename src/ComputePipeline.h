@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace LearningVulkan
+{
+    struct ComputePipelineCreateInfo
+    {
+        // only used for logging
+        std::string Name;
+        std::filesystem::path ShaderPath;
+        VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+    };
+
+    // A compute shader and its layout, recorded with VK_PIPELINE_BIND_POINT_COMPUTE
+    // on any queue that supports compute
+    class ComputePipeline
+    {
+    public:
+        ComputePipeline(const ComputePipelineCreateInfo& createInfo);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline& other) = delete;
+        ComputePipeline(ComputePipeline&& other) = delete;
+        ComputePipeline& operator=(const ComputePipeline& other) = delete;
+
+        VkPipeline GetPipeline() const { return m_Pipeline; }
+        VkPipelineLayout GetLayout() const { return m_Layout; }
+        VkDescriptorSetLayout GetDescriptorSetLayout(uint32_t set) const
+        { return m_SetLayouts.at(set); }
+        const ShaderReflection& GetReflection() const { return m_Reflection; }
+
+        // true if the shader or one of the files it includes is used
+        bool UsesShader(const std::filesystem::path& shaderPath) const;
+
+        // recompiles the shader, the old pipeline is kept if compilation
+        // fails or if the shader's resources no longer match the layout
+        bool Rebuild();
+
+    private:
+        VkPipeline Create(const std::vector<uint32_t>& code) const;
+
+    private:
+        ComputePipelineCreateInfo m_CreateInfo;
+        VkPipeline m_Pipeline = VK_NULL_HANDLE;
+        ShaderReflection m_Reflection;
+        // owned by the layout cache
+        VkPipelineLayout m_Layout;
+        std::vector<VkDescriptorSetLayout> m_SetLayouts;
+        std::vector<std::filesystem::path> m_Dependencies;
+    };
+}
@@ -0,0 +1,173 @@
+#include "DeletionQueue.h"
+
+namespace LearningVulkan
+{
+    DeletionQueue::DeletionQueue(VkDevice device,
+                                 const DeviceDispatch& dispatch)
+        : m_Device(device), m_Dispatch(&dispatch)
+    {
+    }
+
+    DeletionQueue::~DeletionQueue()
+    {
+        FlushAll();
+    }
+
+    void DeletionQueue::Push(Deleter&& deleter)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Deleters.push_back(std::move(deleter));
+    }
+
+    void DeletionQueue::PushBuffer(VkBuffer buffer)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Buffers.push_back(buffer);
+    }
+
+    void DeletionQueue::PushImage(VkImage image)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Images.push_back(image);
+    }
+
+    void DeletionQueue::PushImageView(VkImageView imageView)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().ImageViews.push_back(imageView);
+    }
+
+    void DeletionQueue::PushSampler(VkSampler sampler)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Samplers.push_back(sampler);
+    }
+
+    void DeletionQueue::PushPipeline(VkPipeline pipeline)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Pipelines.push_back(pipeline);
+    }
+
+    void DeletionQueue::PushFramebuffer(VkFramebuffer framebuffer)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Framebuffers.push_back(framebuffer);
+    }
+
+    void DeletionQueue::PushSemaphore(VkSemaphore semaphore)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Semaphores.push_back(semaphore);
+    }
+
+    void DeletionQueue::PushSwapchain(VkSwapchainKHR swapchain)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Swapchains.push_back(swapchain);
+    }
+
+    void DeletionQueue::PushMemory(VkDeviceMemory memory)
+    {
+        std::scoped_lock lock(m_Mutex);
+        GetCurrentBatch().Memory.push_back(memory);
+    }
+
+    void DeletionQueue::Flush(uint64_t completedFrame)
+    {
+        std::vector<Batch> completedBatches;
+
+        {
+            std::scoped_lock lock(m_Mutex);
+            // batches are pushed in frame order
+            while (!m_Batches.empty() &&
+                   m_Batches.front().Frame <= completedFrame)
+            {
+                completedBatches.push_back(std::move(m_Batches.front()));
+                m_Batches.pop_front();
+            }
+        }
+
+        // destroying outside of the lock, deleters are allowed to release
+        // more objects which will end up in the current frame's batch
+        for (Batch& batch : completedBatches)
+            Destroy(batch);
+    }
+
+    void DeletionQueue::FlushAll()
+    {
+        while (true)
+        {
+            Batch batch;
+
+            {
+                std::scoped_lock lock(m_Mutex);
+                if (m_Batches.empty())
+                    break;
+
+                batch = std::move(m_Batches.front());
+                m_Batches.pop_front();
+            }
+
+            Destroy(batch);
+        }
+    }
+
+    void DeletionQueue::EndFrame()
+    {
+        std::scoped_lock lock(m_Mutex);
+        m_CurrentFrame++;
+    }
+
+    uint64_t DeletionQueue::GetCurrentFrame() const
+    {
+        std::scoped_lock lock(m_Mutex);
+        return m_CurrentFrame;
+    }
+
+    DeletionQueue::Batch& DeletionQueue::GetCurrentBatch()
+    {
+        if (m_Batches.empty() || m_Batches.back().Frame != m_CurrentFrame)
+        {
+            Batch& batch = m_Batches.emplace_back();
+            batch.Frame = m_CurrentFrame;
+            return batch;
+        }
+
+        return m_Batches.back();
+    }
+
+    void DeletionQueue::Destroy(Batch& batch)
+    {
+        for (const Deleter& deleter : batch.Deleters)
+            deleter();
+
+        // destroy objects before the objects they reference
+        for (VkPipeline pipeline : batch.Pipelines)
+            m_Dispatch->vkDestroyPipeline(m_Device, pipeline, nullptr);
+
+        for (VkFramebuffer framebuffer : batch.Framebuffers)
+            m_Dispatch->vkDestroyFramebuffer(m_Device, framebuffer, nullptr);
+
+        for (VkImageView imageView : batch.ImageViews)
+            m_Dispatch->vkDestroyImageView(m_Device, imageView, nullptr);
+
+        for (VkSampler sampler : batch.Samplers)
+            m_Dispatch->vkDestroySampler(m_Device, sampler, nullptr);
+
+        for (VkSwapchainKHR swapchain : batch.Swapchains)
+            m_Dispatch->vkDestroySwapchainKHR(m_Device, swapchain, nullptr);
+
+        for (VkImage image : batch.Images)
+            m_Dispatch->vkDestroyImage(m_Device, image, nullptr);
+
+        for (VkBuffer buffer : batch.Buffers)
+            m_Dispatch->vkDestroyBuffer(m_Device, buffer, nullptr);
+
+        for (VkDeviceMemory memory : batch.Memory)
+            m_Dispatch->vkFreeMemory(m_Device, memory, nullptr);
+
+        for (VkSemaphore semaphore : batch.Semaphores)
+            m_Dispatch->vkDestroySemaphore(m_Device, semaphore, nullptr);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "VulkanFunctions.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Holds on to gpu objects that might still be used by frames in
+    // flight. Everything released during a frame is batched together and
+    // destroyed once that frame has finished executing on the gpu
+    class DeletionQueue
+    {
+    public:
+        using Deleter = std::function<void()>;
+
+        DeletionQueue(VkDevice device, const DeviceDispatch& dispatch);
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue& other) = delete;
+        DeletionQueue& operator=(const DeletionQueue& other) = delete;
+
+        // everything pushed will be destroyed after the current frame has
+        // completed
+        void Push(Deleter&& deleter);
+        void PushBuffer(VkBuffer buffer);
+        void PushImage(VkImage image);
+        void PushImageView(VkImageView imageView);
+        void PushSampler(VkSampler sampler);
+        void PushFramebuffer(VkFramebuffer framebuffer);
+        void PushSemaphore(VkSemaphore semaphore);
+        void PushSwapchain(VkSwapchainKHR swapchain);
+        void PushMemory(VkDeviceMemory memory);
+        void PushPipeline(VkPipeline pipeline);
+
+        // destroys every batch released during or before the completed frame
+        void Flush(uint64_t completedFrame);
+        // NOTE: only call when the device is idle
+        void FlushAll();
+
+        void EndFrame();
+        uint64_t GetCurrentFrame() const;
+
+    private:
+        struct Batch
+        {
+            uint64_t Frame;
+            std::vector<Deleter> Deleters;
+            std::vector<VkPipeline> Pipelines;
+            std::vector<VkFramebuffer> Framebuffers;
+            std::vector<VkImageView> ImageViews;
+            std::vector<VkSampler> Samplers;
+            std::vector<VkSwapchainKHR> Swapchains;
+            std::vector<VkImage> Images;
+            std::vector<VkBuffer> Buffers;
+            std::vector<VkDeviceMemory> Memory;
+            std::vector<VkSemaphore> Semaphores;
+        };
+
+        Batch& GetCurrentBatch();
+        void Destroy(Batch& batch);
+
+    private:
+        VkDevice m_Device;
+        const DeviceDispatch* m_Dispatch;
+        std::deque<Batch> m_Batches;
+        // frame 0 is reserved for "nothing submitted yet"
+        uint64_t m_CurrentFrame = 1;
+        mutable std::mutex m_Mutex;
+    };
+}
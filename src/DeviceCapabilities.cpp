@@ -0,0 +1,383 @@
+#include "DeviceCapabilities.h"
+#include "VulkanUtils.h"
+#include "RendererContext.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // for features that only exist as extensions
+        constexpr uint32_t NeverPromoted = 0;
+
+        struct FeatureRequirements
+        {
+            uint32_t PromotedVersion;
+            // needed when the api version is below the promoted one
+            std::vector<const char*> Extensions;
+        };
+
+        const FeatureRequirements PresentWaitRequirements = {
+            NeverPromoted, 
+            { 
+                VK_KHR_PRESENT_ID_EXTENSION_NAME, 
+                VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+            },
+        };
+
+        const FeatureRequirements MemoryBudgetRequirements = {
+            NeverPromoted, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME },
+        };
+
+        const FeatureRequirements TimelineSemaphoreRequirements = {
+            VK_API_VERSION_1_2, { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME },
+        };
+
+        const FeatureRequirements DescriptorIndexingRequirements = {
+            VK_API_VERSION_1_2, { VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME },
+        };
+
+        const FeatureRequirements Synchronization2Requirements = {
+            VK_API_VERSION_1_3, { VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME },
+        };
+
+        const FeatureRequirements DynamicRenderingRequirements = {
+            VK_API_VERSION_1_3,
+            {
+                VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+                // dependencies of dynamic rendering that are core in 1.2
+                VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+                VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+            },
+        };
+
+        const FeatureRequirements BufferDeviceAddressRequirements = {
+            VK_API_VERSION_1_2, 
+            { VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME },
+        };
+
+        // core in 1.4 which we don't request, its dependencies are core 
+        // in 1.3 so it's only used from there on
+        const FeatureRequirements HostImageCopyRequirements = {
+            NeverPromoted, { VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME },
+        };
+    }
+
+    DeviceFeatures DeviceFeatures::All()
+    {
+        DeviceFeatures features;
+        features.SamplerAnisotropy = true;
+        features.PresentWait = true;
+        features.MemoryBudget = true;
+        features.TimelineSemaphores = true;
+        features.DescriptorIndexing = true;
+        features.Synchronization2 = true;
+        features.DynamicRendering = true;
+        features.BufferDeviceAddress = true;
+        features.HostImageCopy = true;
+        return features;
+    }
+
+    uint32_t DeviceFeatures::GetCount() const
+    {
+        return SamplerAnisotropy + PresentWait + MemoryBudget +
+               TimelineSemaphores + DescriptorIndexing + Synchronization2 +
+               DynamicRendering + BufferDeviceAddress + HostImageCopy;
+    }
+
+    void DeviceCapabilities::Print() const
+    {
+        auto printVersion = [](uint32_t version)
+        {
+            std::cout << VK_API_VERSION_MAJOR(version) << '.'
+                      << VK_API_VERSION_MINOR(version) << '.'
+                      << VK_API_VERSION_PATCH(version);
+        };
+
+        std::cout << "Vulkan version: instance ";
+        printVersion(InstanceVersion);
+        std::cout << ", device ";
+        printVersion(DeviceVersion);
+        std::cout << "\nOptional features:\n";
+
+        auto printFeature = [](const char* name, bool enabled)
+        {
+            std::cout << '\t' << name << ": " << (enabled ? "on" : "off")
+                      << '\n';
+        };
+
+        printFeature("Present wait", Features.PresentWait);
+        printFeature("Memory budget", Features.MemoryBudget);
+        printFeature("Timeline semaphores", Features.TimelineSemaphores);
+        printFeature("Descriptor indexing", Features.DescriptorIndexing);
+        printFeature("Synchronization2", Features.Synchronization2);
+        printFeature("Dynamic rendering", Features.DynamicRendering);
+        printFeature("Buffer device address", Features.BufferDeviceAddress);
+        printFeature("Host image copy", Features.HostImageCopy);
+    }
+
+    DeviceFeatureNegotiator::DeviceFeatureNegotiator(
+        VkPhysicalDevice physicalDevice, uint32_t instanceVersion)
+    {
+        VkPhysicalDeviceProperties properties;
+        RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        m_Supported.InstanceVersion = instanceVersion;
+        m_Supported.DeviceVersion = properties.apiVersion;
+        m_Supported.ApiVersion = std::min(instanceVersion, 
+                                          properties.apiVersion);
+
+        uint32_t extensionCount = 0;
+        RendererContext::GetInstanceDispatch().vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
+                                             &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        RendererContext::GetInstanceDispatch().vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
+                                             &extensionCount,
+                                             extensions.data());
+
+        for (const VkExtensionProperties& extension : extensions)
+            m_AvailableExtensions.insert(extension.extensionName);
+
+        // feature structs may only be chained when the device knows them
+        DeviceFeatures available;
+        available.SamplerAnisotropy = true;
+        available.PresentWait = IsAvailable(
+                                    PresentWaitRequirements.PromotedVersion,
+                                    PresentWaitRequirements.Extensions);
+        available.MemoryBudget = IsAvailable(
+                                    MemoryBudgetRequirements.PromotedVersion,
+                                    MemoryBudgetRequirements.Extensions);
+        available.TimelineSemaphores = IsAvailable(
+                            TimelineSemaphoreRequirements.PromotedVersion,
+                            TimelineSemaphoreRequirements.Extensions);
+        available.DescriptorIndexing = IsAvailable(
+                            DescriptorIndexingRequirements.PromotedVersion,
+                            DescriptorIndexingRequirements.Extensions);
+        available.Synchronization2 = IsAvailable(
+                            Synchronization2Requirements.PromotedVersion,
+                            Synchronization2Requirements.Extensions);
+        available.DynamicRendering = IsAvailable(
+                            DynamicRenderingRequirements.PromotedVersion,
+                            DynamicRenderingRequirements.Extensions);
+        available.BufferDeviceAddress = IsAvailable(
+                            BufferDeviceAddressRequirements.PromotedVersion,
+                            BufferDeviceAddressRequirements.Extensions);
+        available.HostImageCopy = 
+            m_Supported.ApiVersion >= VK_API_VERSION_1_3 &&
+            IsAvailable(HostImageCopyRequirements.PromotedVersion,
+                        HostImageCopyRequirements.Extensions);
+
+        ResetFeatures();
+        LinkFeatures(available);
+        RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceFeatures2(physicalDevice, &m_Features);
+
+        DeviceFeatures& supported = m_Supported.Features;
+        supported.SamplerAnisotropy = m_Features.features.samplerAnisotropy;
+        supported.PresentWait = available.PresentWait &&
+                                m_PresentIdFeatures.presentId &&
+                                m_PresentWaitFeatures.presentWait;
+        supported.MemoryBudget = available.MemoryBudget;
+        supported.TimelineSemaphores = available.TimelineSemaphores &&
+                        m_TimelineSemaphoreFeatures.timelineSemaphore;
+        supported.DescriptorIndexing = available.DescriptorIndexing &&
+            m_DescriptorIndexingFeatures.runtimeDescriptorArray &&
+            m_DescriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+            m_DescriptorIndexingFeatures
+                .shaderSampledImageArrayNonUniformIndexing;
+        supported.Synchronization2 = available.Synchronization2 &&
+                        m_Synchronization2Features.synchronization2;
+        supported.DynamicRendering = available.DynamicRendering &&
+                        m_DynamicRenderingFeatures.dynamicRendering;
+        supported.BufferDeviceAddress = available.BufferDeviceAddress &&
+                        m_BufferDeviceAddressFeatures.bufferDeviceAddress;
+        supported.HostImageCopy = available.HostImageCopy &&
+                        m_HostImageCopyFeatures.hostImageCopy;
+    }
+
+    DeviceCapabilities DeviceFeatureNegotiator::Negotiate(
+        const DeviceFeatures& requested)
+    {
+        const DeviceFeatures& supported = m_Supported.Features;
+
+        DeviceCapabilities enabled = m_Supported;
+        DeviceFeatures& features = enabled.Features;
+        features.SamplerAnisotropy = requested.SamplerAnisotropy && 
+                                     supported.SamplerAnisotropy;
+        features.PresentWait = requested.PresentWait && 
+                               supported.PresentWait;
+        features.MemoryBudget = requested.MemoryBudget &&
+                                supported.MemoryBudget;
+        features.TimelineSemaphores = requested.TimelineSemaphores &&
+                                      supported.TimelineSemaphores;
+        features.DescriptorIndexing = requested.DescriptorIndexing &&
+                                      supported.DescriptorIndexing;
+        features.Synchronization2 = requested.Synchronization2 &&
+                                    supported.Synchronization2;
+        features.DynamicRendering = requested.DynamicRendering &&
+                                    supported.DynamicRendering;
+        features.BufferDeviceAddress = requested.BufferDeviceAddress &&
+                                       supported.BufferDeviceAddress;
+        features.HostImageCopy = requested.HostImageCopy &&
+                                 supported.HostImageCopy;
+
+        // structs that aren't linked are ignored, so the members can be
+        // set unconditionally
+        ResetFeatures();
+        LinkFeatures(features);
+        m_Features.features.samplerAnisotropy = features.SamplerAnisotropy;
+        m_PresentIdFeatures.presentId = VK_TRUE;
+        m_PresentWaitFeatures.presentWait = VK_TRUE;
+        m_TimelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+        m_DescriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        m_DescriptorIndexingFeatures.descriptorBindingPartiallyBound = 
+                                                                    VK_TRUE;
+        m_DescriptorIndexingFeatures
+            .shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        m_Synchronization2Features.synchronization2 = VK_TRUE;
+        m_DynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        m_BufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
+        m_HostImageCopyFeatures.hostImageCopy = VK_TRUE;
+
+        m_Extensions.assign(VulkanUtils::DeviceExtensions.begin(),
+                            VulkanUtils::DeviceExtensions.end());
+
+        if (features.PresentWait)
+            AddExtensions(PresentWaitRequirements.PromotedVersion,
+                          PresentWaitRequirements.Extensions);
+        if (features.MemoryBudget)
+            AddExtensions(MemoryBudgetRequirements.PromotedVersion,
+                          MemoryBudgetRequirements.Extensions);
+        if (features.TimelineSemaphores)
+            AddExtensions(TimelineSemaphoreRequirements.PromotedVersion,
+                          TimelineSemaphoreRequirements.Extensions);
+        if (features.DescriptorIndexing)
+            AddExtensions(DescriptorIndexingRequirements.PromotedVersion,
+                          DescriptorIndexingRequirements.Extensions);
+        if (features.Synchronization2)
+            AddExtensions(Synchronization2Requirements.PromotedVersion,
+                          Synchronization2Requirements.Extensions);
+        if (features.DynamicRendering)
+            AddExtensions(DynamicRenderingRequirements.PromotedVersion,
+                          DynamicRenderingRequirements.Extensions);
+        if (features.BufferDeviceAddress)
+            AddExtensions(BufferDeviceAddressRequirements.PromotedVersion,
+                          BufferDeviceAddressRequirements.Extensions);
+        if (features.HostImageCopy)
+            AddExtensions(HostImageCopyRequirements.PromotedVersion,
+                          HostImageCopyRequirements.Extensions);
+
+        return enabled;
+    }
+
+    bool DeviceFeatureNegotiator::IsExtensionAvailable(
+        const char* extension) const
+    {
+        return m_AvailableExtensions.contains(extension);
+    }
+
+    bool DeviceFeatureNegotiator::IsAvailable(uint32_t promotedVersion,
+        const std::vector<const char*>& extensions) const
+    {
+        if (promotedVersion != NeverPromoted &&
+            m_Supported.ApiVersion >= promotedVersion)
+            return true;
+
+        return std::all_of(extensions.begin(), extensions.end(),
+            [this](const char* extension)
+            {
+                return IsExtensionAvailable(extension);
+            });
+    }
+
+    void DeviceFeatureNegotiator::AddExtensions(uint32_t promotedVersion,
+        const std::vector<const char*>& extensions)
+    {
+        if (promotedVersion != NeverPromoted &&
+            m_Supported.ApiVersion >= promotedVersion)
+            return;
+
+        for (const char* extension : extensions)
+        {
+            // features can share dependencies
+            if (std::find_if(m_Extensions.begin(), m_Extensions.end(),
+                    [extension](const char* enabled)
+                    {
+                        return std::string_view(enabled) == extension;
+                    }) == m_Extensions.end())
+                m_Extensions.push_back(extension);
+        }
+    }
+
+    void DeviceFeatureNegotiator::LinkFeatures(
+        const DeviceFeatures& features)
+    {
+        void** next = &m_Features.pNext;
+        auto link = [&next](auto& featureStruct)
+        {
+            *next = &featureStruct;
+            next = &featureStruct.pNext;
+        };
+
+        if (features.PresentWait)
+        {
+            link(m_PresentIdFeatures);
+            link(m_PresentWaitFeatures);
+        }
+
+        if (features.TimelineSemaphores)
+            link(m_TimelineSemaphoreFeatures);
+        if (features.DescriptorIndexing)
+            link(m_DescriptorIndexingFeatures);
+        if (features.Synchronization2)
+            link(m_Synchronization2Features);
+        if (features.DynamicRendering)
+            link(m_DynamicRenderingFeatures);
+        if (features.BufferDeviceAddress)
+            link(m_BufferDeviceAddressFeatures);
+        if (features.HostImageCopy)
+            link(m_HostImageCopyFeatures);
+
+        *next = nullptr;
+    }
+
+    void DeviceFeatureNegotiator::ResetFeatures()
+    {
+        m_Features = {};
+        m_Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+        m_PresentIdFeatures = {};
+        m_PresentIdFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+
+        m_PresentWaitFeatures = {};
+        m_PresentWaitFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+        m_TimelineSemaphoreFeatures = {};
+        m_TimelineSemaphoreFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+        m_DescriptorIndexingFeatures = {};
+        m_DescriptorIndexingFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+        m_Synchronization2Features = {};
+        m_Synchronization2Features.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+
+        m_DynamicRenderingFeatures = {};
+        m_DynamicRenderingFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+        m_BufferDeviceAddressFeatures = {};
+        m_BufferDeviceAddressFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+
+        m_HostImageCopyFeatures = {};
+        m_HostImageCopyFeatures.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Optional device features, used both to request features and to
+    // report which ones ended up enabled
+    struct DeviceFeatures
+    {
+        bool SamplerAnisotropy = false;
+        bool PresentWait = false;
+        bool MemoryBudget = false;
+        bool TimelineSemaphores = false;
+        // runtime sized, partially bound and non uniformly indexed
+        // sampled image arrays
+        bool DescriptorIndexing = false;
+        bool Synchronization2 = false;
+        bool DynamicRendering = false;
+        bool BufferDeviceAddress = false;
+        // copies and layout transitions of images done by the cpu
+        bool HostImageCopy = false;
+
+        static DeviceFeatures All();
+        // number of features that are set
+        uint32_t GetCount() const;
+    };
+
+    struct DeviceCapabilities
+    {
+        uint32_t InstanceVersion = VK_API_VERSION_1_0;
+        uint32_t DeviceVersion = VK_API_VERSION_1_0;
+        // the lower of the two, what we can actually use
+        uint32_t ApiVersion = VK_API_VERSION_1_0;
+        DeviceFeatures Features;
+
+        void Print() const;
+    };
+
+    // Probes the versions, extensions and features of a physical device
+    // and builds the extension list and pNext chain that enable a 
+    // requested set of optional features. Features that were promoted to 
+    // core are enabled without their extension when the version allows it
+    class DeviceFeatureNegotiator
+    {
+    public:
+        DeviceFeatureNegotiator(VkPhysicalDevice physicalDevice,
+                                uint32_t instanceVersion);
+
+        // the chain points into the negotiator
+        DeviceFeatureNegotiator(const DeviceFeatureNegotiator& other) = delete;
+        DeviceFeatureNegotiator& operator=(
+            const DeviceFeatureNegotiator& other) = delete;
+
+        // everything the device could enable
+        const DeviceCapabilities& GetSupported() const { return m_Supported; }
+
+        // enables the requested features that are supported and returns 
+        // what will be enabled, the chain and extensions are valid after
+        DeviceCapabilities Negotiate(const DeviceFeatures& requested);
+        const VkPhysicalDeviceFeatures2* GetFeatureChain() const
+        {
+            return &m_Features;
+        }
+        const std::vector<const char*>& GetExtensions() const 
+        { 
+            return m_Extensions; 
+        }
+
+    private:
+        bool IsExtensionAvailable(const char* extension) const;
+        // core since promotedVersion or available through the extensions
+        bool IsAvailable(uint32_t promotedVersion,
+                         const std::vector<const char*>& extensions) const;
+        void AddExtensions(uint32_t promotedVersion,
+                           const std::vector<const char*>& extensions);
+        // links the structs of the features in the chain
+        void LinkFeatures(const DeviceFeatures& features);
+        void ResetFeatures();
+
+    private:
+        DeviceCapabilities m_Supported;
+        std::set<std::string> m_AvailableExtensions;
+        std::vector<const char*> m_Extensions;
+
+        VkPhysicalDeviceFeatures2 m_Features{};
+        VkPhysicalDevicePresentIdFeaturesKHR m_PresentIdFeatures{};
+        VkPhysicalDevicePresentWaitFeaturesKHR m_PresentWaitFeatures{};
+        VkPhysicalDeviceTimelineSemaphoreFeatures m_TimelineSemaphoreFeatures{};
+        VkPhysicalDeviceDescriptorIndexingFeatures m_DescriptorIndexingFeatures{};
+        VkPhysicalDeviceSynchronization2Features m_Synchronization2Features{};
+        VkPhysicalDeviceDynamicRenderingFeatures m_DynamicRenderingFeatures{};
+        VkPhysicalDeviceBufferDeviceAddressFeatures m_BufferDeviceAddressFeatures{};
+        VkPhysicalDeviceHostImageCopyFeaturesEXT m_HostImageCopyFeatures{};
+    };
+}
@@ -0,0 +1,70 @@
+#include "FramePacer.h"
+
+#include <cassert>
+#include <thread>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // sleeping isn't precise enough, so the last bit is spent spinning
+        constexpr std::chrono::microseconds SpinThreshold(2000);
+    }
+
+    FramePacer::FramePacer(FramePacingMode mode, double targetFrameRate)
+        : m_Mode(mode)
+    {
+        SetTargetFrameRate(targetFrameRate);
+        m_NextFrameTime = Clock::now();
+    }
+
+    void FramePacer::SetMode(FramePacingMode mode)
+    {
+        m_Mode = mode;
+        m_NextFrameTime = Clock::now();
+    }
+
+    void FramePacer::SetTargetFrameRate(double targetFrameRate)
+    {
+        assert(targetFrameRate > 0.0);
+        m_TargetFrameDuration =
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / targetFrameRate));
+    }
+
+    PresentMode FramePacer::GetPreferredPresentMode() const
+    {
+        switch (m_Mode)
+        {
+        case FramePacingMode::LowLatency: return PresentMode::Mailbox;
+        case FramePacingMode::VSync: return PresentMode::Fifo;
+        case FramePacingMode::Capped: return PresentMode::Mailbox;
+        }
+
+        return PresentMode::Fifo;
+    }
+
+    void FramePacer::WaitForNextFrame()
+    {
+        if (m_Mode != FramePacingMode::Capped)
+            return;
+
+        OPTICK_CATEGORY("WaitForNextFrame", Optick::Category::Wait);
+
+        Clock::time_point now = Clock::now();
+
+        // we fell more than a frame behind, don't try to catch up
+        if (now > m_NextFrameTime + m_TargetFrameDuration)
+            m_NextFrameTime = now;
+
+        if (m_NextFrameTime - now > SpinThreshold)
+            std::this_thread::sleep_until(m_NextFrameTime - SpinThreshold);
+
+        while (Clock::now() < m_NextFrameTime)
+            std::this_thread::yield();
+
+        m_NextFrameTime += m_TargetFrameDuration;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Swapchain.h"
+
+#include <chrono>
+
+namespace LearningVulkan
+{
+    enum class FramePacingMode
+    {
+        // present as soon as possible, without tearing when supported
+        LowLatency,
+        // locked to the display refresh, frames are started right after the
+        // previous one was presented when VK_KHR_present_wait is available
+        VSync,
+        // like LowLatency, but the cpu is limited to a target frame rate
+        Capped,
+    };
+
+    class FramePacer
+    {
+    public:
+        FramePacer(FramePacingMode mode = FramePacingMode::LowLatency,
+                   double targetFrameRate = 60.0);
+
+        void SetMode(FramePacingMode mode);
+        void SetTargetFrameRate(double targetFrameRate);
+
+        FramePacingMode GetMode() const { return m_Mode; }
+        PresentMode GetPreferredPresentMode() const;
+
+        // blocks until the next frame is allowed to start,
+        // only does anything in capped mode
+        void WaitForNextFrame();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        FramePacingMode m_Mode;
+        Clock::duration m_TargetFrameDuration;
+        Clock::time_point m_NextFrameTime;
+    };
+}
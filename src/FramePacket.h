@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Camera.h"
+#include "GraphicsPipeline.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace LearningVulkan
+{
+    struct DrawItem
+    {
+        // index of the cube in the renderer's index buffer
+        uint32_t Mesh = 0;
+        PipelineVariantKey Variant = PipelineVariantKey::All();
+        glm::vec4 Tint = glm::vec4(1.0f);
+    };
+
+    // Everything the main thread produces for one frame, the render thread
+    // only reads it so it can record while the next packet is being filled
+    struct FramePacket
+    {
+        CameraState Camera;
+        // the size of the window when the packet was built
+        VkExtent2D Extent = { 0, 0 };
+        std::vector<DrawItem> Draws;
+    };
+}
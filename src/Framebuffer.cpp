@@ -35,12 +35,13 @@ namespace LearningVulkan
 		framebufferCreateInfo.height = m_Height;
 		framebufferCreateInfo.layers = 1;
 
-		assert(vkCreateFramebuffer(RendererContext::GetLogicalDevice()->GetVulkanDevice(),
+		assert(RendererContext::GetDeviceDispatch().vkCreateFramebuffer(RendererContext::GetLogicalDevice()->GetVulkanDevice(),
 			&framebufferCreateInfo, nullptr, &m_Framebuffer) == VK_SUCCESS);
 	}
 
 	void Framebuffer::Destroy()
 	{
-		vkDestroyFramebuffer(RendererContext::GetLogicalDevice()->GetVulkanDevice(), m_Framebuffer, nullptr);
+		// the framebuffer can still be used by frames in flight
+		RendererContext::GetDeletionQueue()->PushFramebuffer(m_Framebuffer);
 	}
 }
@@ -1,66 +1,101 @@
 #include "GPUBuffer.h"
 #include "RendererContext.h"
 
+#include <optick.h>
+
 namespace LearningVulkan
 {
-	 GPUBuffer::GPUBuffer(VkBufferUsageFlags buffer_usage, VkDeviceSize buffer_size, VkMemoryPropertyFlags memory_properties)
-		 : m_BufferSize(buffer_size)
+	 GPUBuffer::GPUBuffer(VkBufferUsageFlags buffer_usage, VkDeviceSize buffer_size, VkMemoryPropertyFlags memory_properties, MemoryCategory category,
+		 ResourceSharing sharing)
+		 : m_BufferSize(buffer_size), m_Concurrent(sharing == ResourceSharing::Concurrent)
 	 {
-		 Create(buffer_usage, buffer_size, memory_properties);
+		 Create(buffer_usage, buffer_size, memory_properties, category);
 	 }
 
 	GPUBuffer::~GPUBuffer()
 	{
-		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-		vkDestroyBuffer(logicalDevice->GetVulkanDevice(), m_Buffer, nullptr);
-		vkFreeMemory(logicalDevice->GetVulkanDevice(), m_BufferMemory, nullptr);
+		// accounted as freed right away, the budget catches up once the
+		// deletion queue actually frees it
+		RendererContext::GetMemoryTracker()->TrackFree(m_BufferMemory);
+
+		// the buffer can still be used by frames in flight
+		DeletionQueue* deletionQueue = RendererContext::GetDeletionQueue();
+		deletionQueue->PushBuffer(m_Buffer);
+		deletionQueue->PushMemory(m_BufferMemory);
 	}
 
 	void* GPUBuffer::MapMemory()
 	{
 		void* data;
 		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-		assert(vkMapMemory(logicalDevice->GetVulkanDevice(), m_BufferMemory, 0, m_BufferSize, 0, &data) == VK_SUCCESS);
+		assert(RendererContext::GetDeviceDispatch().vkMapMemory(logicalDevice->GetVulkanDevice(), m_BufferMemory, 0, m_BufferSize, 0, &data) == VK_SUCCESS);
 		return data;
 	}
 
 	void GPUBuffer::UnmapMemory()
 	{
 		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-		vkUnmapMemory(logicalDevice->GetVulkanDevice(), m_BufferMemory);
+		RendererContext::GetDeviceDispatch().vkUnmapMemory(logicalDevice->GetVulkanDevice(), m_BufferMemory);
+	}
+
+	uint32_t GPUBuffer::GetMemoryTypeBits(VkBufferUsageFlags usage)
+	{
+		VkDevice device = RendererContext::GetLogicalDevice()->GetVulkanDevice();
+		const DeviceDispatch& dispatch = RendererContext::GetDeviceDispatch();
+
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = 1;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		bufferCreateInfo.usage = usage;
+
+		// never bound or used, so it doesn't need the deletion queue
+		VkBuffer buffer;
+		assert(dispatch.vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) == VK_SUCCESS);
+
+		VkMemoryRequirements memoryRequirements;
+		dispatch.vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+		dispatch.vkDestroyBuffer(device, buffer, nullptr);
+		return memoryRequirements.memoryTypeBits;
 	}
 
-	void GPUBuffer::Create(VkBufferUsageFlags usage, VkDeviceSize size, VkMemoryPropertyFlags memoryProperties)
+	void GPUBuffer::Create(VkBufferUsageFlags usage, VkDeviceSize size, VkMemoryPropertyFlags memoryProperties, MemoryCategory category)
 	{
+		OPTICK_EVENT();
+		OPTICK_TAG("Size", size);
+
 		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-		const QueueFamilyIndices& queueFamilyIndices = logicalDevice->GetPhysicalDevice()->GetQueueFamilyIndices();
+		std::vector<uint32_t> queueFamilies = logicalDevice->GetQueueFamilies();
 
-		std::array queueFamilyArr
-	 	{
-			queueFamilyIndices.GraphicsFamily.value(),
-			queueFamilyIndices.TransferFamily.value(),
-		};
+		// concurrent sharing needs two distinct families
+		m_Concurrent = m_Concurrent && queueFamilies.size() > 1;
 
 		VkBufferCreateInfo bufferCreateInfo{};
 		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferCreateInfo.size = size;
-		bufferCreateInfo.queueFamilyIndexCount = queueFamilyArr.size();
-		bufferCreateInfo.pQueueFamilyIndices = queueFamilyArr.data();
-		bufferCreateInfo.sharingMode = queueFamilyIndices.GraphicsFamily.value() != queueFamilyIndices.TransferFamily.value() ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (m_Concurrent)
+		{
+			bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferCreateInfo.queueFamilyIndexCount = queueFamilies.size();
+			bufferCreateInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
 		bufferCreateInfo.usage = usage;
 
-		assert(vkCreateBuffer(logicalDevice->GetVulkanDevice(), &bufferCreateInfo, nullptr, &m_Buffer) == VK_SUCCESS);
+		assert(RendererContext::GetDeviceDispatch().vkCreateBuffer(logicalDevice->GetVulkanDevice(), &bufferCreateInfo, nullptr, &m_Buffer) == VK_SUCCESS);
 
 		VkMemoryRequirements memoryRequirements;
-		vkGetBufferMemoryRequirements(logicalDevice->GetVulkanDevice(), m_Buffer, &memoryRequirements);
+		RendererContext::GetDeviceDispatch().vkGetBufferMemoryRequirements(logicalDevice->GetVulkanDevice(), m_Buffer, &memoryRequirements);
 
 		VkMemoryAllocateInfo memoryAllocateInfo{};
 		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		memoryAllocateInfo.allocationSize = memoryRequirements.size;
-		memoryAllocateInfo.memoryTypeIndex = logicalDevice->GetPhysicalDevice()->FindMemoryType(memoryRequirements.memoryTypeBits, memoryProperties);
+		MemoryTracker* memoryTracker = RendererContext::GetMemoryTracker();
+		memoryAllocateInfo.memoryTypeIndex = memoryTracker->FindMemoryType(memoryRequirements.memoryTypeBits, memoryProperties, memoryRequirements.size);
 
-		assert(vkAllocateMemory(logicalDevice->GetVulkanDevice(), &memoryAllocateInfo, nullptr, &m_BufferMemory) == VK_SUCCESS);
+		assert(RendererContext::GetDeviceDispatch().vkAllocateMemory(logicalDevice->GetVulkanDevice(), &memoryAllocateInfo, nullptr, &m_BufferMemory) == VK_SUCCESS);
+		memoryTracker->TrackAllocation(m_BufferMemory, memoryRequirements.size, memoryAllocateInfo.memoryTypeIndex, category);
 
-		assert(vkBindBufferMemory(logicalDevice->GetVulkanDevice(), m_Buffer, m_BufferMemory, 0) == VK_SUCCESS);
+		assert(RendererContext::GetDeviceDispatch().vkBindBufferMemory(logicalDevice->GetVulkanDevice(), m_Buffer, m_BufferMemory, 0) == VK_SUCCESS);
 	}
 }
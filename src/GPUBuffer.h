@@ -1,13 +1,19 @@
 #pragma once
 
+#include "MemoryTracker.h"
+#include "QueueOwnership.h"
+
 #include <vulkan/vulkan.h>
 
+#include <optional>
+
 namespace LearningVulkan
 {
     class GPUBuffer
     {
     public:
-        GPUBuffer(VkBufferUsageFlags buffer_usage, VkDeviceSize buffer_size, VkMemoryPropertyFlags memory_properties);
+        GPUBuffer(VkBufferUsageFlags buffer_usage, VkDeviceSize buffer_size, VkMemoryPropertyFlags memory_properties, MemoryCategory category,
+                  ResourceSharing sharing = ResourceSharing::Exclusive);
         ~GPUBuffer();
         GPUBuffer(const GPUBuffer& other) = delete;
         GPUBuffer(GPUBuffer&& other) = delete;
@@ -20,14 +26,24 @@ namespace LearningVulkan
         void* MapMemory();
         void UnmapMemory();
 
+        // true between a release and the matching acquire
+        bool IsOwnershipTransferPending() const { return m_PendingTransfer.has_value(); }
+
         static void Copy(const GPUBuffer*, const GPUBuffer*, VkDeviceSize size);
+        // the memory types a buffer with the usage can be bound to, which
+        // only depend on the usage and not on the size
+        static uint32_t GetMemoryTypeBits(VkBufferUsageFlags usage);
 
     private:
-        void Create(VkBufferUsageFlags usage, VkDeviceSize size, VkMemoryPropertyFlags memoryProperties);
+        void Create(VkBufferUsageFlags usage, VkDeviceSize size, VkMemoryPropertyFlags memoryProperties, MemoryCategory category);
 
     private:
         VkBuffer m_Buffer;
         VkDeviceMemory m_BufferMemory;
         VkDeviceSize m_BufferSize;
+        bool m_Concurrent = false;
+        std::optional<PendingOwnershipTransfer> m_PendingTransfer;
+
+        friend class CommandBuffer;
     };
 }
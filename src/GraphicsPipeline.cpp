@@ -0,0 +1,517 @@
+#include "GraphicsPipeline.h"
+
+#include "LayoutCache.h"
+#include "LogicalDevice.h"
+#include "RendererContext.h"
+#include "ShaderCompiler.h"
+#include "Vertex.h"
+
+#include <array>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    GraphicsPipeline::GraphicsPipeline(
+        const GraphicsPipelineCreateInfo& createInfo)
+        : m_CreateInfo(createInfo)
+    {
+        ShaderCompiler* compiler = RendererContext::GetShaderCompiler();
+        std::vector<uint32_t> vertexShaderCode = compiler->Compile(
+            m_CreateInfo.VertexShaderPath, ShaderStage::Vertex);
+        std::vector<uint32_t> fragmentShaderCode = compiler->Compile(
+            m_CreateInfo.FragmentShaderPath, ShaderStage::Fragment);
+
+        // there is nothing to fall back to on the first build
+        assert(!vertexShaderCode.empty() && !fragmentShaderCode.empty());
+
+        m_Program = CreateProgram(std::move(vertexShaderCode),
+                                  std::move(fragmentShaderCode));
+        m_Layout = RendererContext::GetLayoutCache()->GetPipelineLayout(
+                                            m_Program->Reflection, m_SetLayouts);
+        UpdateDependencies();
+    }
+
+    GraphicsPipeline::~GraphicsPipeline()
+    {
+        DeletionQueue* deletionQueue = RendererContext::GetDeletionQueue();
+
+        // compiles still running have to finish before their pipelines
+        // can be released
+        for (auto& future : m_Discarded)
+            deletionQueue->PushPipeline(future.get().Pipeline);
+
+        // the variants can still be used by frames in flight
+        for (const auto& [key, variant] : m_Variants)
+        {
+            if (variant.Pending.valid())
+                deletionQueue->PushPipeline(variant.Pending.get().Pipeline);
+
+            if (variant.Pipeline != VK_NULL_HANDLE)
+                deletionQueue->PushPipeline(variant.Pipeline);
+        }
+    }
+
+    VkPipeline GraphicsPipeline::GetVariant(PipelineVariantKey key)
+    {
+        Variant& variant = m_Variants[key];
+        if (variant.Pipeline == VK_NULL_HANDLE && !variant.Pending.valid())
+        {
+            variant.Pending = StartCompile(key);
+            // compiles without a compiler are done right away
+            FinishCompile(key, variant);
+        }
+
+        if (variant.Pipeline != VK_NULL_HANDLE)
+            return variant.Pipeline;
+
+        if (m_FallbackVariant.has_value() && *m_FallbackVariant != key)
+            return GetVariant(*m_FallbackVariant);
+
+        return VK_NULL_HANDLE;
+    }
+
+    std::shared_future<PipelineCompileResult> GraphicsPipeline::RequestVariant(
+        PipelineVariantKey key)
+    {
+        Variant& variant = m_Variants[key];
+        if (variant.Pending.valid())
+            return variant.Pending;
+
+        if (variant.Pipeline == VK_NULL_HANDLE)
+        {
+            variant.Pending = StartCompile(key);
+            return variant.Pending;
+        }
+
+        std::promise<PipelineCompileResult> ready;
+        ready.set_value({ variant.Pipeline, 0.0 });
+        return ready.get_future().share();
+    }
+
+    void GraphicsPipeline::SetFallbackVariant(PipelineVariantKey key)
+    {
+        m_FallbackVariant = key;
+        RequestVariant(key);
+    }
+
+    void GraphicsPipeline::Update()
+    {
+        for (auto& [key, variant] : m_Variants)
+            FinishCompile(key, variant);
+
+        std::erase_if(m_Discarded,
+            [](const std::shared_future<PipelineCompileResult>& future)
+            {
+                if (future.wait_for(std::chrono::seconds(0)) != 
+                    std::future_status::ready)
+                    return false;
+
+                RendererContext::GetDeletionQueue()->PushPipeline(
+                                                    future.get().Pipeline);
+                return true;
+            });
+    }
+
+    bool GraphicsPipeline::UsesShader(
+        const std::filesystem::path& shaderPath) const
+    {
+        return std::find(m_Dependencies.begin(), m_Dependencies.end(),
+                         shaderPath.lexically_normal()) != m_Dependencies.end();
+    }
+
+    bool GraphicsPipeline::Rebuild()
+    {
+        ShaderCompiler* compiler = RendererContext::GetShaderCompiler();
+        std::vector<uint32_t> vertexShaderCode = compiler->Compile(
+            m_CreateInfo.VertexShaderPath, ShaderStage::Vertex);
+        std::vector<uint32_t> fragmentShaderCode = compiler->Compile(
+            m_CreateInfo.FragmentShaderPath, ShaderStage::Fragment);
+
+        // the include graph may have changed even if compilation failed
+        UpdateDependencies();
+
+        if (vertexShaderCode.empty() || fragmentShaderCode.empty())
+            return false;
+
+        std::shared_ptr<const ShaderProgram> program = CreateProgram(
+            std::move(vertexShaderCode), std::move(fragmentShaderCode));
+
+        // descriptor sets allocated for the old layout can't be used with
+        // a different one, so that still requires a restart
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        if (RendererContext::GetLayoutCache()->GetPipelineLayout(
+                program->Reflection, setLayouts) != m_Layout)
+        {
+            std::cerr << "Shader resources of " 
+                      << m_CreateInfo.VertexShaderPath << " and "
+                      << m_CreateInfo.FragmentShaderPath 
+                      << " changed, restart to apply\n";
+            return false;
+        }
+
+        m_Program = std::move(program);
+
+        // recompile the variants that were requested, the rest stay lazy
+        for (auto& [key, variant] : m_Variants)
+        {
+            if (variant.Pending.valid())
+                m_Discarded.push_back(std::move(variant.Pending));
+
+            variant.Pending = StartCompile(key);
+            FinishCompile(key, variant);
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<const GraphicsPipeline::ShaderProgram> 
+        GraphicsPipeline::CreateProgram(
+            std::vector<uint32_t>&& vertexShaderCode,
+            std::vector<uint32_t>&& fragmentShaderCode)
+    {
+        auto program = std::make_shared<ShaderProgram>();
+        program->Reflection = ShaderReflection::Reflect(
+                                vertexShaderCode, VK_SHADER_STAGE_VERTEX_BIT);
+        program->Reflection.Merge(ShaderReflection::Reflect(
+                            fragmentShaderCode, VK_SHADER_STAGE_FRAGMENT_BIT));
+        program->VertexShaderCode = std::move(vertexShaderCode);
+        program->FragmentShaderCode = std::move(fragmentShaderCode);
+        return program;
+    }
+
+    std::shared_future<PipelineCompileResult> GraphicsPipeline::StartCompile(
+        PipelineVariantKey key)
+    {
+        // the program is captured so a rebuild can't change it underneath
+        auto compile = [this, key, program = m_Program]()
+        {
+            return Create(key, *program);
+        };
+
+        if (m_CreateInfo.Compiler != nullptr)
+            return m_CreateInfo.Compiler->Submit(compile);
+
+        auto start = std::chrono::steady_clock::now();
+        std::promise<PipelineCompileResult> result;
+        result.set_value({ compile(), std::chrono::duration<double, 
+            std::milli>(std::chrono::steady_clock::now() - start).count() });
+        return result.get_future().share();
+    }
+
+    bool GraphicsPipeline::FinishCompile(PipelineVariantKey key,
+                                         Variant& variant)
+    {
+        if (variant.Pending.valid() && 
+            variant.Pending.wait_for(std::chrono::seconds(0)) == 
+                                                std::future_status::ready)
+        {
+            PipelineCompileResult result = variant.Pending.get();
+            variant.Pending = {};
+
+            // the previous pipeline can still be used by frames in flight
+            if (variant.Pipeline != VK_NULL_HANDLE)
+                RendererContext::GetDeletionQueue()->PushPipeline(
+                                                            variant.Pipeline);
+            variant.Pipeline = result.Pipeline;
+
+            std::cout << "Compiled pipeline " << m_CreateInfo.Name 
+                      << " variant " << key.Features << " in " 
+                      << result.Milliseconds << "ms\n";
+        }
+
+        return variant.Pipeline != VK_NULL_HANDLE;
+    }
+
+    void GraphicsPipeline::UpdateDependencies()
+    {
+        m_Dependencies = ShaderCompiler::GetDependencies(
+                                            m_CreateInfo.VertexShaderPath);
+
+        std::vector<std::filesystem::path> fragmentDependencies =
+            ShaderCompiler::GetDependencies(m_CreateInfo.FragmentShaderPath);
+        m_Dependencies.insert(m_Dependencies.end(),
+                              fragmentDependencies.begin(),
+                              fragmentDependencies.end());
+    }
+
+    VkPipeline GraphicsPipeline::Create(PipelineVariantKey key,
+                                        const ShaderProgram& program) const
+    {
+        OPTICK_EVENT();
+        OPTICK_TAG("Features", key.Features);
+
+        VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
+        graphicsPipelineCreateInfo.sType =
+                            VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+        VkShaderModule vertexShaderModule = 
+                                        CreateShader(program.VertexShaderCode);
+        VkShaderModule fragmentShaderModule = 
+                                    CreateShader(program.FragmentShaderCode);
+
+#pragma region Specialization
+            // every feature is a bool constant with the feature as its id,
+            // entries for ids a shader doesn't declare are ignored
+            constexpr uint32_t featureCount = 
+                                static_cast<uint32_t>(ShaderFeature::Count);
+            std::array<VkBool32, featureCount> featureValues{};
+            std::array<VkSpecializationMapEntry, featureCount> mapEntries{};
+            for (uint32_t i = 0; i < featureCount; i++)
+            {
+                featureValues[i] = key.IsEnabled(static_cast<ShaderFeature>(i));
+                mapEntries[i].constantID = i;
+                mapEntries[i].offset = i * sizeof(VkBool32);
+                mapEntries[i].size = sizeof(VkBool32);
+            }
+
+            VkSpecializationInfo specializationInfo{};
+            specializationInfo.mapEntryCount = mapEntries.size();
+            specializationInfo.pMapEntries = mapEntries.data();
+            specializationInfo.dataSize = sizeof(featureValues);
+            specializationInfo.pData = featureValues.data();
+#pragma endregion
+
+
+#pragma region Shader Stages
+            VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo{};
+            vertexShaderStageCreateInfo.sType = 
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            vertexShaderStageCreateInfo.module = vertexShaderModule;
+            vertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            vertexShaderStageCreateInfo.pName = "main";
+            vertexShaderStageCreateInfo.pSpecializationInfo = 
+                                                        &specializationInfo;
+
+            VkPipelineShaderStageCreateInfo fragmentShaderStageCreateInfo{};
+            fragmentShaderStageCreateInfo.sType =
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            fragmentShaderStageCreateInfo.module = fragmentShaderModule;
+            fragmentShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            fragmentShaderStageCreateInfo.pName = "main";
+            fragmentShaderStageCreateInfo.pSpecializationInfo = 
+                                                        &specializationInfo;
+
+            std::array shaderStages =
+            {
+                vertexShaderStageCreateInfo,
+                fragmentShaderStageCreateInfo
+            };
+
+            graphicsPipelineCreateInfo.pStages = shaderStages.data();
+            graphicsPipelineCreateInfo.stageCount = shaderStages.size();
+#pragma endregion
+
+
+#pragma region Vertex Input State
+            VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
+            vertexInputCreateInfo.sType =
+                    VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+            // the attributes are expected to be tightly packed into a 
+            // single vertex buffer in location order
+            std::vector<VkVertexInputAttributeDescription> 
+                                                vertexAttributeDescription;
+            uint32_t vertexStride = 0;
+            for (const VertexInputAttribute& input : 
+                 program.Reflection.VertexInputs)
+            {
+                // the vertex buffer is filled from the c++ Vertex
+                assert(input.Location < VertexAttributeOffsets.size() &&
+                       VertexAttributeOffsets.at(input.Location) == 
+                       vertexStride);
+
+                vertexAttributeDescription.push_back({
+                    .location = input.Location,
+                    .binding = 0,
+                    .format = input.Format,
+                    .offset = vertexStride,
+                });
+                vertexStride += input.Size;
+            }
+
+            assert(vertexStride == 0 || vertexStride == sizeof(Vertex));
+
+            VkVertexInputBindingDescription vertexBindingDescription{};
+            vertexBindingDescription.binding = 0;
+            vertexBindingDescription.stride = vertexStride;
+            vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            if (vertexStride > 0)
+            {
+                vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+                vertexInputCreateInfo.pVertexBindingDescriptions = 
+                                                    &vertexBindingDescription;
+            }
+
+            vertexInputCreateInfo.vertexAttributeDescriptionCount =
+                                            vertexAttributeDescription.size();
+            vertexInputCreateInfo.pVertexAttributeDescriptions =
+                                            vertexAttributeDescription.data();
+
+            graphicsPipelineCreateInfo.pVertexInputState =
+                                                        &vertexInputCreateInfo;
+#pragma endregion
+
+#pragma region Input Assembly State
+            VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{};
+            inputAssemblyStateCreateInfo.sType = 
+                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            inputAssemblyStateCreateInfo.topology =
+                                        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+            graphicsPipelineCreateInfo.pInputAssemblyState =
+                                                &inputAssemblyStateCreateInfo;
+#pragma endregion
+
+#pragma region Dynamic States
+            std::array dynamicStates =
+            {
+                VK_DYNAMIC_STATE_VIEWPORT,
+                VK_DYNAMIC_STATE_SCISSOR
+            };
+
+            VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+            dynamicStateCreateInfo.sType = 
+                        VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
+            dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+            
+            graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+#pragma endregion
+
+#pragma region Viewport State
+            VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
+            viewportStateCreateInfo.sType = 
+                        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            // not setting the actual viewport and scissor states just how many 
+            // there will be
+            // that's because both are dynamic and will be specified later
+            viewportStateCreateInfo.scissorCount = 1;
+            viewportStateCreateInfo.viewportCount = 1;
+
+            graphicsPipelineCreateInfo.pViewportState = 
+                                                    &viewportStateCreateInfo;
+#pragma endregion
+
+#pragma region Rasterization State
+            VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
+            rasterizationStateCreateInfo.sType = 
+                    VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+
+            // if true, then the fragments outside the depth range 
+            // (the near and far planes) will be clamped, 
+            // else they will be discarded
+            // using this requires a gpu feature
+            rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
+            rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+
+            rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+            rasterizationStateCreateInfo.lineWidth = 1.0f;
+            rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+            rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
+
+            graphicsPipelineCreateInfo.pRasterizationState = 
+                                                &rasterizationStateCreateInfo;
+#pragma endregion
+
+#pragma region Multisample State
+            VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo{};
+            multisampleStateCreateInfo.sType = 
+                    VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            multisampleStateCreateInfo.rasterizationSamples = 
+                                                        VK_SAMPLE_COUNT_1_BIT;
+
+            graphicsPipelineCreateInfo.pMultisampleState = 
+                                                &multisampleStateCreateInfo;
+#pragma endregion
+
+
+#pragma region Color Blending
+            VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
+
+            // specifies to which color components to write to
+            colorBlendAttachmentState.colorWriteMask =
+                VK_COLOR_COMPONENT_R_BIT
+                | VK_COLOR_COMPONENT_G_BIT
+                | VK_COLOR_COMPONENT_B_BIT
+                | VK_COLOR_COMPONENT_A_BIT;
+
+            colorBlendAttachmentState.blendEnable = VK_FALSE;
+            /* color blending op
+            VkPipelineColorBlendAttachmentState pipelineColorBlendAttachmentState2{};
+            pipelineColorBlendAttachmentState2.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            pipelineColorBlendAttachmentState2.blendEnable = VK_TRUE;
+            pipelineColorBlendAttachmentState2.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            pipelineColorBlendAttachmentState2.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            pipelineColorBlendAttachmentState2.colorBlendOp = VK_BLEND_OP_ADD;
+            pipelineColorBlendAttachmentState2.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineColorBlendAttachmentState2.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            pipelineColorBlendAttachmentState2.alphaBlendOp = VK_BLEND_OP_ADD;
+            */
+
+
+            VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{};
+            colorBlendStateCreateInfo.sType = 
+                    VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            colorBlendStateCreateInfo.attachmentCount = 1;
+            colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
+            colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
+
+            graphicsPipelineCreateInfo.pColorBlendState = 
+                                                    &colorBlendStateCreateInfo;
+#pragma  endregion
+
+#pragma region Pipeline Layout
+            graphicsPipelineCreateInfo.layout = m_Layout;
+#pragma endregion
+
+#pragma region Render Pass;
+            graphicsPipelineCreateInfo.renderPass = m_CreateInfo.RenderPass;
+            graphicsPipelineCreateInfo.subpass = 0;
+#pragma endregion
+
+#pragma region Depth Stencil State
+            VkPipelineDepthStencilStateCreateInfo pipelineDepthStencilCreateInfo{};
+            pipelineDepthStencilCreateInfo.sType = 
+                    VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            pipelineDepthStencilCreateInfo.depthTestEnable = VK_TRUE;
+            pipelineDepthStencilCreateInfo.depthWriteEnable = VK_TRUE;
+            pipelineDepthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+            graphicsPipelineCreateInfo.pDepthStencilState = 
+                                            &pipelineDepthStencilCreateInfo;
+#pragma endregion
+
+        VkPipeline pipeline;
+        VkDevice device = RendererContext::GetLogicalDevice()->GetVulkanDevice();
+        assert(RendererContext::GetDeviceDispatch().vkCreateGraphicsPipelines(device, m_CreateInfo.PipelineCache,
+                                         1, &graphicsPipelineCreateInfo,
+                                         nullptr, &pipeline) == VK_SUCCESS);
+
+        RendererContext::GetDeviceDispatch().vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+        RendererContext::GetDeviceDispatch().vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+        return pipeline;
+    }
+
+    VkShaderModule GraphicsPipeline::CreateShader(
+        const std::vector<uint32_t>& code)
+    {
+        VkShaderModuleCreateInfo shaderModuleCreateInfo{};
+        shaderModuleCreateInfo.sType = 
+                                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);
+        shaderModuleCreateInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        assert(RendererContext::GetDeviceDispatch().vkCreateShaderModule(
+            RendererContext::GetLogicalDevice()->GetVulkanDevice(),
+            &shaderModuleCreateInfo, nullptr, &shaderModule) == VK_SUCCESS);
+        return shaderModule;
+    }
+}
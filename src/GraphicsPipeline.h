@@ -0,0 +1,152 @@
+#pragma once
+
+#include "PipelineCompiler.h"
+#include "ShaderReflection.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // features of the uber shaders that can be toggled per variant,
+    // the value is the constant_id of the matching bool specialization
+    // constant
+    enum class ShaderFeature : uint32_t
+    {
+        Texturing = 0,
+        VertexColor = 1,
+
+        Count,
+    };
+
+    struct PipelineVariantKey
+    {
+        uint32_t Features = 0;
+
+        static PipelineVariantKey All()
+        {
+            return { (1u << static_cast<uint32_t>(ShaderFeature::Count)) - 1 };
+        }
+
+        PipelineVariantKey& Enable(ShaderFeature feature)
+        {
+            Features |= 1u << static_cast<uint32_t>(feature);
+            return *this;
+        }
+
+        PipelineVariantKey& Disable(ShaderFeature feature)
+        {
+            Features &= ~(1u << static_cast<uint32_t>(feature));
+            return *this;
+        }
+
+        bool IsEnabled(ShaderFeature feature) const
+        {
+            return Features & (1u << static_cast<uint32_t>(feature));
+        }
+
+        auto operator<=>(const PipelineVariantKey& other) const = default;
+    };
+
+    struct GraphicsPipelineCreateInfo
+    {
+        // only used for logging
+        std::string Name;
+        std::filesystem::path VertexShaderPath;
+        std::filesystem::path FragmentShaderPath;
+        VkRenderPass RenderPass;
+        VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+        // variants are compiled in the background when set, otherwise
+        // they are created the first time they are requested
+        PipelineCompiler* Compiler = nullptr;
+    };
+
+    // A pipeline and all of its specialization constant variants. Variants
+    // share the shader code and layout and are only created when first used
+    class GraphicsPipeline
+    {
+    public:
+        GraphicsPipeline(const GraphicsPipelineCreateInfo& createInfo);
+        ~GraphicsPipeline();
+
+        GraphicsPipeline(const GraphicsPipeline& other) = delete;
+        GraphicsPipeline(GraphicsPipeline&& other) = delete;
+        GraphicsPipeline& operator=(const GraphicsPipeline& other) = delete;
+
+        // returns the variant if it's ready, otherwise starts compiling it
+        // and returns the fallback variant, or VK_NULL_HANDLE if that 
+        // isn't ready either and the draw should be skipped
+        VkPipeline GetVariant(PipelineVariantKey key);
+        std::shared_future<PipelineCompileResult> RequestVariant(
+            PipelineVariantKey key);
+        void SetFallbackVariant(PipelineVariantKey key);
+
+        // puts finished compiles into use, call once per frame
+        void Update();
+
+        VkPipelineLayout GetLayout() const { return m_Layout; }
+        VkDescriptorSetLayout GetDescriptorSetLayout(uint32_t set) const
+        { return m_SetLayouts.at(set); }
+        const ShaderReflection& GetReflection() const
+        { return m_Program->Reflection; }
+
+        // true if the shader or one of the files it includes is used
+        bool UsesShader(const std::filesystem::path& shaderPath) const;
+
+        // recompiles the shaders and recreates every variant, the old
+        // variants stay in use until the new ones are ready and are kept 
+        // if compilation fails or if the shaders' resources no longer 
+        // match the layout
+        bool Rebuild();
+
+    private:
+        // immutable once created so compiles in flight can keep using it
+        // while a rebuild replaces it
+        struct ShaderProgram
+        {
+            std::vector<uint32_t> VertexShaderCode;
+            std::vector<uint32_t> FragmentShaderCode;
+            ShaderReflection Reflection;
+        };
+
+        struct Variant
+        {
+            VkPipeline Pipeline = VK_NULL_HANDLE;
+            std::shared_future<PipelineCompileResult> Pending;
+        };
+
+        static std::shared_ptr<const ShaderProgram> CreateProgram(
+            std::vector<uint32_t>&& vertexShaderCode,
+            std::vector<uint32_t>&& fragmentShaderCode);
+        VkPipeline Create(PipelineVariantKey key,
+                          const ShaderProgram& program) const;
+        static VkShaderModule CreateShader(const std::vector<uint32_t>& code);
+        void UpdateDependencies();
+
+        std::shared_future<PipelineCompileResult> StartCompile(
+            PipelineVariantKey key);
+        // returns true once the variant has a pipeline
+        bool FinishCompile(PipelineVariantKey key, Variant& variant);
+
+    private:
+        GraphicsPipelineCreateInfo m_CreateInfo;
+        std::shared_ptr<const ShaderProgram> m_Program;
+        std::map<PipelineVariantKey, Variant> m_Variants;
+        std::optional<PipelineVariantKey> m_FallbackVariant;
+        // compiles that were superseded by a rebuild before finishing
+        std::vector<std::shared_future<PipelineCompileResult>> m_Discarded;
+        // owned by the layout cache
+        VkPipelineLayout m_Layout;
+        std::vector<VkDescriptorSetLayout> m_SetLayouts;
+        std::vector<std::filesystem::path> m_Dependencies;
+    };
+}
@@ -4,34 +4,44 @@
 #include "vulkan/vulkan_core.h"
 
 #include <vulkan/vulkan.h>
+#include <optick.h>
 
 namespace LearningVulkan {
     Image::Image(const ImageCreateInfo& imageCreateInfo)
 		: m_Width(imageCreateInfo.Width), 
         m_Height(imageCreateInfo.Height),
         m_Format(imageCreateInfo.Format),
-        m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED)
+        m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED),
+        m_AspectFlags(imageCreateInfo.AspectFlags),
+        m_Concurrent(imageCreateInfo.Sharing == ResourceSharing::Concurrent)
 	{
 		CreateImage(m_Width, m_Height, m_Format, 
               imageCreateInfo.Tiling, imageCreateInfo.Usage,
-              imageCreateInfo.MemoryProperties);
+              imageCreateInfo.MemoryProperties, imageCreateInfo.Category);
 
         CreateView(m_Format, imageCreateInfo.AspectFlags);
 	}
 
 	Image::~Image()
 	{
-		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-		vkDestroyImageView(logicalDevice->GetVulkanDevice(), m_ImageView, nullptr);
-		vkDestroyImage(logicalDevice->GetVulkanDevice(), m_Image, nullptr);
-		vkFreeMemory(logicalDevice->GetVulkanDevice(), m_ImageMemory, nullptr);
+		RendererContext::GetMemoryTracker()->TrackFree(m_ImageMemory);
+
+		// the image can still be used by frames in flight
+		DeletionQueue* deletionQueue = RendererContext::GetDeletionQueue();
+		deletionQueue->PushImageView(m_ImageView);
+		deletionQueue->PushImage(m_Image);
+		deletionQueue->PushMemory(m_ImageMemory);
 	}
 
 	void Image::CreateImage(uint32_t width, uint32_t height, 
 		VkFormat format, VkImageTiling imageTiling,
 		VkImageUsageFlags imageUsage,
-		VkMemoryPropertyFlags memoryProperties) 
+		VkMemoryPropertyFlags memoryProperties, MemoryCategory category) 
 	{
+		OPTICK_EVENT();
+		OPTICK_TAG("Width", width);
+		OPTICK_TAG("Height", height);
+
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageCreateInfo.format = format;
@@ -44,32 +54,31 @@ namespace LearningVulkan {
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
 		imageCreateInfo.mipLevels = 1;
 		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
 		LogicalDevice* logicalDevice = 
 			RendererContext::GetLogicalDevice();
-		PhysicalDevice* physicalDevice = 
-			logicalDevice->GetPhysicalDevice();
-		const auto& queueFamilyIndices = 
-			physicalDevice->GetQueueFamilyIndices();
+		std::vector<uint32_t> queueFamilies = 
+			logicalDevice->GetQueueFamilies();
 
-		std::array queueFamilyIndicesArr = 
-		{
-			queueFamilyIndices.GraphicsFamily.value(),
-			queueFamilyIndices.TransferFamily.value(),
-		};
+		// concurrent sharing needs two distinct families
+		m_Concurrent = m_Concurrent && queueFamilies.size() > 1;
 
-		imageCreateInfo.queueFamilyIndexCount = 
-			queueFamilyIndicesArr.size();
-		imageCreateInfo.pQueueFamilyIndices = 
-			queueFamilyIndicesArr.data();
-
-		assert(vkCreateImage(logicalDevice->GetVulkanDevice(), 
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (m_Concurrent)
+		{
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageCreateInfo.queueFamilyIndexCount = 
+				queueFamilies.size();
+			imageCreateInfo.pQueueFamilyIndices = 
+				queueFamilies.data();
+		}
+
+		assert(RendererContext::GetDeviceDispatch().vkCreateImage(logicalDevice->GetVulkanDevice(), 
 			&imageCreateInfo, nullptr, &m_Image) == VK_SUCCESS);
 		
 		VkMemoryRequirements imageMemoryRequirements;
-		vkGetImageMemoryRequirements(logicalDevice->GetVulkanDevice(),
+		RendererContext::GetDeviceDispatch().vkGetImageMemoryRequirements(logicalDevice->GetVulkanDevice(),
 			       m_Image, &imageMemoryRequirements);
 
 		VkMemoryAllocateInfo imageMemoryAllocateInfo{};
@@ -77,19 +86,73 @@ namespace LearningVulkan {
 			VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		imageMemoryAllocateInfo.allocationSize = 
 			imageMemoryRequirements.size;
+		MemoryTracker* memoryTracker = RendererContext::GetMemoryTracker();
 		imageMemoryAllocateInfo.memoryTypeIndex = 
-			physicalDevice->FindMemoryType(
+			memoryTracker->FindMemoryType(
 				imageMemoryRequirements.memoryTypeBits,
-				memoryProperties);
+				memoryProperties, imageMemoryRequirements.size);
 
-		assert(vkAllocateMemory(logicalDevice->GetVulkanDevice(),
+		assert(RendererContext::GetDeviceDispatch().vkAllocateMemory(logicalDevice->GetVulkanDevice(),
 			&imageMemoryAllocateInfo, nullptr, &m_ImageMemory) 
 		== VK_SUCCESS);
+		memoryTracker->TrackAllocation(m_ImageMemory,
+			imageMemoryRequirements.size,
+			imageMemoryAllocateInfo.memoryTypeIndex, category);
 
-		assert(vkBindImageMemory(logicalDevice->GetVulkanDevice(),
+		assert(RendererContext::GetDeviceDispatch().vkBindImageMemory(logicalDevice->GetVulkanDevice(),
 			m_Image, m_ImageMemory, 0) == VK_SUCCESS);
 	}
 
+	void Image::CopyFromHost(const void* pixels, VkImageLayout layout)
+	{
+		OPTICK_EVENT();
+		LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
+
+		// copied straight into the final layout, going through another
+		// one would need a host transition to a layout it can't target
+		assert(logicalDevice->CanHostCopyTo(layout));
+		TransitionLayoutOnHost(layout);
+
+		VkMemoryToImageCopyEXT region{};
+		region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+		region.pHostPointer = pixels;
+		// zero means tightly packed
+		region.memoryRowLength = 0;
+		region.memoryImageHeight = 0;
+		region.imageSubresource.aspectMask = m_AspectFlags;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { m_Width, m_Height, 1 };
+
+		VkCopyMemoryToImageInfoEXT copyInfo{};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+		copyInfo.dstImage = m_Image;
+		copyInfo.dstImageLayout = layout;
+		copyInfo.regionCount = 1;
+		copyInfo.pRegions = &region;
+
+		logicalDevice->CopyMemoryToImage(copyInfo);
+	}
+
+	void Image::TransitionLayoutOnHost(VkImageLayout newLayout)
+	{
+		VkHostImageLayoutTransitionInfoEXT transition{};
+		transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+		transition.image = m_Image;
+		transition.oldLayout = m_CurrentLayout;
+		transition.newLayout = newLayout;
+		transition.subresourceRange.aspectMask = m_AspectFlags;
+		transition.subresourceRange.baseMipLevel = 0;
+		transition.subresourceRange.levelCount = 1;
+		transition.subresourceRange.baseArrayLayer = 0;
+		transition.subresourceRange.layerCount = 1;
+
+		RendererContext::GetLogicalDevice()->TransitionImageLayout(transition);
+		m_CurrentLayout = newLayout;
+	}
+
     void Image::CreateView(VkFormat imageFormat, VkImageAspectFlags imageAspect)
     {
         VkImageViewCreateInfo imageViewCreateInfo{};
@@ -105,7 +168,7 @@ namespace LearningVulkan {
 
         LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
 
-        assert(vkCreateImageView(logicalDevice->GetVulkanDevice(), &imageViewCreateInfo, nullptr, &m_ImageView) == VK_SUCCESS);
+        assert(RendererContext::GetDeviceDispatch().vkCreateImageView(logicalDevice->GetVulkanDevice(), &imageViewCreateInfo, nullptr, &m_ImageView) == VK_SUCCESS);
     }
 }
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "MemoryTracker.h"
+#include "QueueOwnership.h"
+
 #include <vulkan/vulkan.h>
 
+#include <optional>
+
 namespace LearningVulkan 
 {
     struct ImageCreateInfo
@@ -12,6 +17,8 @@ namespace LearningVulkan
         VkImageUsageFlags Usage;
         VkMemoryPropertyFlags MemoryProperties;
         VkImageAspectFlags AspectFlags;
+        MemoryCategory Category = MemoryCategory::Texture;
+        ResourceSharing Sharing = ResourceSharing::Exclusive;
     };
 
     class Image
@@ -44,9 +51,20 @@ namespace LearningVulkan
         { 
             return m_Format; 
         }
+
+        VkImageAspectFlags GetAspectFlags() const { return m_AspectFlags; }
+
+        // true between a release and the matching acquire
+        bool IsOwnershipTransferPending() const { return m_PendingTransfer.has_value(); }
+
+        // writes tightly packed pixels from the cpu and leaves the image in
+        // the layout, needs host image copy to support the layout and the
+        // host transfer usage
+        void CopyFromHost(const void* pixels, VkImageLayout layout);
     private:
-        void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsage, VkMemoryPropertyFlags memoryProperties);
+        void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsage, VkMemoryPropertyFlags memoryProperties, MemoryCategory category);
         void CreateView(VkFormat imageFormat, VkImageAspectFlags imageAspect);
+        void TransitionLayoutOnHost(VkImageLayout newLayout);
 
     private:
         VkImage m_Image;
@@ -55,6 +73,9 @@ namespace LearningVulkan
         uint32_t m_Width, m_Height;
         VkImageLayout m_CurrentLayout;
         VkFormat m_Format;
+        VkImageAspectFlags m_AspectFlags;
+        bool m_Concurrent;
+        std::optional<PendingOwnershipTransfer> m_PendingTransfer;
 
         friend class CommandBuffer;
     };
@@ -0,0 +1,186 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        constexpr uint32_t NotAWorker = UINT32_MAX;
+
+        // the worker running on this thread, its index is only meaningful
+        // to the system that owns it
+        struct WorkerIdentity
+        {
+            const JobSystem* Owner = nullptr;
+            uint32_t Index = NotAWorker;
+        };
+        thread_local WorkerIdentity t_Worker;
+    }
+
+    JobSystem::JobSystem(uint32_t workerCount)
+    {
+        if (workerCount == 0)
+        {
+            // can report 0 if it's unknown
+            uint32_t threadCount = std::thread::hardware_concurrency();
+            workerCount = threadCount > 1 ? threadCount - 1 : 1;
+        }
+
+        for (uint32_t i = 0; i < workerCount; i++)
+            m_Queues.push_back(std::make_unique<Queue>());
+
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            m_Workers.emplace_back([this, i](std::stop_token stopToken)
+            {
+                WorkerLoop(i, stopToken);
+            });
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        for (std::jthread& worker : m_Workers)
+            worker.request_stop();
+
+        m_SleepCondition.notify_all();
+        m_Workers.clear();
+    }
+
+    void JobSystem::Schedule(Job&& job, JobCounter* counter)
+    {
+        if (counter != nullptr)
+        {
+            counter->m_Pending++;
+            job = [job = std::move(job), counter]()
+            {
+                job();
+                counter->m_Pending--;
+            };
+        }
+
+        {
+            // taken so a worker can't miss the notification between 
+            // checking for jobs and going to sleep. Counted before the job
+            // is published, a thief could otherwise run it and decrement
+            // first
+            std::scoped_lock lock(m_SleepMutex);
+            m_QueuedJobs++;
+        }
+
+        // workers push to their own queue so the job stays on a warm cache
+        uint32_t workerIndex = GetWorkerIndex();
+        uint32_t queueIndex = workerIndex != NotAWorker 
+                                ? workerIndex 
+                                : m_NextQueue++ % m_Queues.size();
+        {
+            Queue& queue = *m_Queues[queueIndex];
+            std::scoped_lock lock(queue.Mutex);
+            queue.Jobs.push_back(std::move(job));
+        }
+
+        m_SleepCondition.notify_one();
+    }
+
+    void JobSystem::Wait(const JobCounter& counter)
+    {
+        OPTICK_EVENT();
+
+        uint32_t workerIndex = GetWorkerIndex();
+        uint32_t queueIndex = workerIndex != NotAWorker ? workerIndex : 0;
+        while (!counter.IsDone())
+        {
+            // help out instead of blocking
+            if (!TryRunJob(queueIndex))
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::ParallelFor(uint32_t begin, uint32_t end,
+                                uint32_t batchSize, const RangeJob& job)
+    {
+        assert(batchSize > 0);
+
+        JobCounter counter;
+        for (uint32_t batchBegin = begin; batchBegin < end; 
+             batchBegin += batchSize)
+        {
+            uint32_t batchEnd = std::min(end, batchBegin + batchSize);
+            Schedule([&job, batchBegin, batchEnd]()
+            {
+                job(batchBegin, batchEnd);
+            }, &counter);
+        }
+
+        Wait(counter);
+    }
+
+    void JobSystem::WorkerLoop(uint32_t workerIndex, std::stop_token stopToken)
+    {
+        std::string threadName = "Job Worker " + std::to_string(workerIndex);
+        OPTICK_THREAD(threadName.c_str());
+
+        t_Worker = { this, workerIndex };
+        while (!stopToken.stop_requested())
+        {
+            if (TryRunJob(workerIndex))
+                continue;
+
+            std::unique_lock lock(m_SleepMutex);
+            m_SleepCondition.wait(lock, stopToken, 
+                                  [this] { return m_QueuedJobs > 0; });
+        }
+    }
+
+    uint32_t JobSystem::GetWorkerIndex() const
+    {
+        return t_Worker.Owner == this ? t_Worker.Index : NotAWorker;
+    }
+
+    bool JobSystem::TryRunJob(uint32_t queueIndex)
+    {
+        Job job;
+        if (!PopJob(queueIndex, job) && !StealJob(queueIndex, job))
+            return false;
+
+        m_QueuedJobs--;
+        job();
+        return true;
+    }
+
+    bool JobSystem::PopJob(uint32_t queueIndex, Job& job)
+    {
+        Queue& queue = *m_Queues[queueIndex];
+        std::scoped_lock lock(queue.Mutex);
+        if (queue.Jobs.empty())
+            return false;
+
+        // newest first, its data is most likely still in cache
+        job = std::move(queue.Jobs.back());
+        queue.Jobs.pop_back();
+        return true;
+    }
+
+    bool JobSystem::StealJob(uint32_t thiefIndex, Job& job)
+    {
+        for (uint32_t i = 1; i < m_Queues.size(); i++)
+        {
+            Queue& queue = *m_Queues[(thiefIndex + i) % m_Queues.size()];
+            std::scoped_lock lock(queue.Mutex);
+            if (queue.Jobs.empty())
+                continue;
+
+            // oldest first, those are usually the biggest chunks of work
+            job = std::move(queue.Jobs.front());
+            queue.Jobs.pop_front();
+            return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Tracks a group of jobs, a job that is waited on is done once the
+    // counter drops back to zero
+    class JobCounter
+    {
+    public:
+        bool IsDone() const { return m_Pending.load() == 0; }
+
+    private:
+        std::atomic<uint32_t> m_Pending = 0;
+
+        friend class JobSystem;
+    };
+
+    // Runs jobs on a fixed set of worker threads. Every worker owns a 
+    // deque, it takes work from the back of its own and steals from the 
+    // front of the others' when it runs out.
+    // NOTE: jobs can schedule and wait on other jobs
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+        // processes the indices in [begin, end)
+        using RangeJob = std::function<void(uint32_t begin, uint32_t end)>;
+
+        // 0 creates a worker for every hardware thread except the caller's
+        JobSystem(uint32_t workerCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem& other) = delete;
+        JobSystem& operator=(const JobSystem& other) = delete;
+
+        void Schedule(Job&& job, JobCounter* counter = nullptr);
+        // runs other jobs on the calling thread until the counter is done
+        void Wait(const JobCounter& counter);
+
+        // splits the range into batches of at most batchSize indices 
+        // and waits for all of them
+        void ParallelFor(uint32_t begin, uint32_t end, uint32_t batchSize,
+                         const RangeJob& job);
+
+        uint32_t GetWorkerCount() const { return m_Queues.size(); }
+
+    private:
+        struct Queue
+        {
+            std::mutex Mutex;
+            std::deque<Job> Jobs;
+        };
+
+        void WorkerLoop(uint32_t workerIndex, std::stop_token stopToken);
+        // UINT32_MAX unless called from one of this system's workers
+        uint32_t GetWorkerIndex() const;
+        bool TryRunJob(uint32_t queueIndex);
+        bool PopJob(uint32_t queueIndex, Job& job);
+        bool StealJob(uint32_t thiefIndex, Job& job);
+
+    private:
+        std::vector<std::unique_ptr<Queue>> m_Queues;
+        // spreads jobs scheduled from outside of the workers
+        std::atomic<uint32_t> m_NextQueue = 0;
+
+        // idle workers sleep until a job is scheduled
+        std::atomic<uint32_t> m_QueuedJobs = 0;
+        std::mutex m_SleepMutex;
+        std::condition_variable_any m_SleepCondition;
+
+        // declared last so they're joined before the queues are destroyed
+        std::vector<std::jthread> m_Workers;
+    };
+}
@@ -0,0 +1,88 @@
+#include "JobSystemBenchmark.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        constexpr uint32_t ElementCount = 1 << 20;
+        constexpr uint32_t BatchSize = 4096;
+        constexpr uint32_t Iterations = 64;
+        constexpr uint32_t Runs = 5;
+
+        // stands in for something like a transform update, enough math
+        // per element that the scheduling overhead isn't all we measure
+        void ProcessRange(std::vector<float>& data, uint32_t begin, 
+                          uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                float value = data[i];
+                for (uint32_t j = 0; j < Iterations; j++)
+                    value = std::sin(value) * 0.5f + std::cos(value) * 0.5f;
+
+                data[i] = value;
+            }
+        }
+
+        template<typename Function>
+        double MeasureBest(std::vector<float>& data, Function&& function)
+        {
+            double best = INFINITY;
+            for (uint32_t run = 0; run < Runs; run++)
+            {
+                std::fill(data.begin(), data.end(), 1.0f);
+
+                auto start = std::chrono::steady_clock::now();
+                function();
+                std::chrono::duration<double, std::milli> duration = 
+                                    std::chrono::steady_clock::now() - start;
+
+                best = std::min(best, duration.count());
+            }
+
+            return best;
+        }
+    }
+
+    void RunJobSystemBenchmark()
+    {
+        std::vector<float> data(ElementCount);
+
+        double serial = MeasureBest(data, [&data]()
+        {
+            ProcessRange(data, 0, ElementCount);
+        });
+
+        std::cout << "Job system benchmark, " << ElementCount 
+                  << " elements in batches of " << BatchSize << '\n';
+        std::cout << "\t1 thread (serial): " << serial << "ms\n";
+
+        // the thread calling ParallelFor runs jobs too
+        uint32_t threadCount = std::max(2u, 
+                                        std::thread::hardware_concurrency());
+        for (uint32_t workers = 1; workers < threadCount; workers++)
+        {
+            JobSystem jobSystem(workers);
+            double parallel = MeasureBest(data, [&]()
+            {
+                jobSystem.ParallelFor(0, ElementCount, BatchSize,
+                    [&data](uint32_t begin, uint32_t end)
+                    {
+                        ProcessRange(data, begin, end);
+                    });
+            });
+
+            std::cout << '\t' << workers + 1 << " threads: " << parallel 
+                      << "ms, " << serial / parallel << "x speedup\n";
+        }
+    }
+}
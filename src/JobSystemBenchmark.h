@@ -0,0 +1,8 @@
+#pragma once
+
+namespace LearningVulkan
+{
+    // measures how ParallelFor scales from 1 to all hardware threads
+    // and prints the results
+    void RunJobSystemBenchmark();
+}
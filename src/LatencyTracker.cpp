@@ -0,0 +1,40 @@
+#include "LatencyTracker.h"
+
+#include <algorithm>
+
+namespace LearningVulkan
+{
+    void LatencyTracker::AddSample(Clock::duration latency)
+    {
+        std::scoped_lock lock(m_Mutex);
+        m_Samples[m_NextSample] =
+            std::chrono::duration<double, std::milli>(latency).count();
+        m_NextSample = (m_NextSample + 1) % SampleCount;
+        m_SampleCount = std::min(m_SampleCount + 1, SampleCount);
+    }
+
+    LatencyStatistics LatencyTracker::GetStatistics() const
+    {
+        std::scoped_lock lock(m_Mutex);
+        LatencyStatistics statistics;
+        if (m_SampleCount == 0)
+            return statistics;
+
+        statistics.SampleCount = m_SampleCount;
+        statistics.MinMilliseconds = m_Samples[0];
+        statistics.MaxMilliseconds = m_Samples[0];
+
+        double total = 0.0;
+        for (uint32_t i = 0; i < m_SampleCount; i++)
+        {
+            total += m_Samples[i];
+            statistics.MinMilliseconds = 
+                std::min(statistics.MinMilliseconds, m_Samples[i]);
+            statistics.MaxMilliseconds = 
+                std::max(statistics.MaxMilliseconds, m_Samples[i]);
+        }
+
+        statistics.AverageMilliseconds = total / m_SampleCount;
+        return statistics;
+    }
+}
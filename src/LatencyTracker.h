@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace LearningVulkan
+{
+    struct LatencyStatistics
+    {
+        double AverageMilliseconds = 0.0;
+        double MinMilliseconds = 0.0;
+        double MaxMilliseconds = 0.0;
+        uint32_t SampleCount = 0;
+    };
+
+    // Keeps the last SampleCount latency samples around.
+    // NOTE: can be used from any thread
+    class LatencyTracker
+    {
+    public:
+        static constexpr uint32_t SampleCount = 128;
+        using Clock = std::chrono::steady_clock;
+
+        void AddSample(Clock::duration latency);
+        LatencyStatistics GetStatistics() const;
+
+    private:
+        mutable std::mutex m_Mutex;
+        std::array<double, SampleCount> m_Samples{};
+        uint32_t m_NextSample = 0;
+        uint32_t m_SampleCount = 0;
+    };
+}
@@ -0,0 +1,110 @@
+#include "LayoutCache.h"
+#include "RendererContext.h"
+
+#include <cassert>
+
+namespace LearningVulkan
+{
+    LayoutCache::LayoutCache(VkDevice device)
+        : m_Device(device)
+    {
+    }
+
+    LayoutCache::~LayoutCache()
+    {
+        for (const auto& [key, pipelineLayout] : m_PipelineLayouts)
+            RendererContext::GetDeviceDispatch().vkDestroyPipelineLayout(m_Device, pipelineLayout, nullptr);
+
+        for (const auto& [key, setLayout] : m_DescriptorSetLayouts)
+            RendererContext::GetDeviceDispatch().vkDestroyDescriptorSetLayout(m_Device, setLayout, nullptr);
+    }
+
+    VkDescriptorSetLayout LayoutCache::GetDescriptorSetLayout(
+        const std::vector<DescriptorBinding>& bindings)
+    {
+        std::vector<DescriptorBinding> key = bindings;
+        for (DescriptorBinding& binding : key)
+            binding.Set = 0;
+
+        std::scoped_lock lock(m_Mutex);
+        auto it = m_DescriptorSetLayouts.find(key);
+        if (it != m_DescriptorSetLayouts.end())
+            return it->second;
+
+        std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+        layoutBindings.reserve(key.size());
+        for (const DescriptorBinding& binding : key)
+        {
+            VkDescriptorSetLayoutBinding layoutBinding{};
+            layoutBinding.binding = binding.Binding;
+            layoutBinding.descriptorType = binding.Type;
+            layoutBinding.descriptorCount = binding.Count;
+            layoutBinding.stageFlags = binding.Stages;
+            layoutBindings.push_back(layoutBinding);
+        }
+
+        VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+        descriptorSetLayoutCreateInfo.sType = 
+                        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutCreateInfo.bindingCount = layoutBindings.size();
+        descriptorSetLayoutCreateInfo.pBindings = layoutBindings.data();
+
+        VkDescriptorSetLayout setLayout;
+        assert(RendererContext::GetDeviceDispatch().vkCreateDescriptorSetLayout(m_Device, 
+                                           &descriptorSetLayoutCreateInfo,
+                                           nullptr, &setLayout) == VK_SUCCESS);
+
+        m_DescriptorSetLayouts.emplace(std::move(key), setLayout);
+        return setLayout;
+    }
+
+    VkPipelineLayout LayoutCache::GetPipelineLayout(
+        const std::vector<VkDescriptorSetLayout>& setLayouts,
+        uint32_t pushConstantSize, VkShaderStageFlags pushConstantStages)
+    {
+        PipelineLayoutKey key = { setLayouts, pushConstantSize, 
+                                  pushConstantStages };
+
+        std::scoped_lock lock(m_Mutex);
+        auto it = m_PipelineLayouts.find(key);
+        if (it != m_PipelineLayouts.end())
+            return it->second;
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = pushConstantSize;
+        pushConstantRange.stageFlags = pushConstantStages;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = 
+                                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = setLayouts.size();
+        pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+        if (pushConstantSize > 0)
+        {
+            pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+            pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        }
+
+        VkPipelineLayout pipelineLayout;
+        assert(RendererContext::GetDeviceDispatch().vkCreatePipelineLayout(m_Device, &pipelineLayoutCreateInfo,
+                                      nullptr, &pipelineLayout) == VK_SUCCESS);
+
+        m_PipelineLayouts.emplace(std::move(key), pipelineLayout);
+        return pipelineLayout;
+    }
+
+    VkPipelineLayout LayoutCache::GetPipelineLayout(
+        const ShaderReflection& reflection,
+        std::vector<VkDescriptorSetLayout>& setLayouts)
+    {
+        // sets without bindings still need a layout if a later set is used
+        setLayouts.clear();
+        for (uint32_t set = 0; set < reflection.GetSetCount(); set++)
+            setLayouts.push_back(GetDescriptorSetLayout(
+                                            reflection.GetSetBindings(set)));
+
+        return GetPipelineLayout(setLayouts, reflection.PushConstantSize,
+                                 reflection.PushConstantStages);
+    }
+}
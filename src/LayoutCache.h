@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <vulkan/vulkan.h>
+
+#include <compare>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Owns every descriptor set and pipeline layout. Identical layouts are
+    // only created once, so pipelines built from shaders with matching
+    // resources share layouts and stay compatible with bound sets
+    class LayoutCache
+    {
+    public:
+        LayoutCache(VkDevice device);
+        ~LayoutCache();
+
+        LayoutCache(const LayoutCache& other) = delete;
+        LayoutCache& operator=(const LayoutCache& other) = delete;
+
+        // the set field of the bindings is ignored
+        VkDescriptorSetLayout GetDescriptorSetLayout(
+            const std::vector<DescriptorBinding>& bindings);
+
+        VkPipelineLayout GetPipelineLayout(
+            const std::vector<VkDescriptorSetLayout>& setLayouts,
+            uint32_t pushConstantSize, VkShaderStageFlags pushConstantStages);
+
+        // creates the set layouts and the pipeline layout for the
+        // resources of a whole pipeline
+        VkPipelineLayout GetPipelineLayout(const ShaderReflection& reflection,
+            std::vector<VkDescriptorSetLayout>& setLayouts);
+
+    private:
+        struct PipelineLayoutKey
+        {
+            std::vector<VkDescriptorSetLayout> SetLayouts;
+            uint32_t PushConstantSize;
+            VkShaderStageFlags PushConstantStages;
+
+            auto operator<=>(const PipelineLayoutKey& other) const = default;
+        };
+
+    private:
+        VkDevice m_Device;
+        std::mutex m_Mutex;
+        std::map<std::vector<DescriptorBinding>, VkDescriptorSetLayout>
+                                                    m_DescriptorSetLayouts;
+        std::map<PipelineLayoutKey, VkPipelineLayout> m_PipelineLayouts;
+    };
+}
@@ -1,54 +1,224 @@
 #include "LogicalDevice.h"
 #include "PhysicalDevice.h"
+#include "RendererContext.h"
+#include "SubmitBatcher.h"
 #include "vulkan/vulkan_core.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 
+#include <optick.h>
+
 namespace LearningVulkan 
 {
-	LogicalDevice::LogicalDevice(VkDevice device, PhysicalDevice* physicalDevice)
-		: m_LogicalDevice(device), m_PhysicalDevice(physicalDevice)
+	LogicalDevice::LogicalDevice(VkDevice device, PhysicalDevice* physicalDevice, const DeviceCapabilities& capabilities)
+		: m_LogicalDevice(device), m_PhysicalDevice(physicalDevice), m_Capabilities(capabilities)
 	{
+		m_Dispatch.Load(device, RendererContext::GetInstanceDispatch(), m_Capabilities.ApiVersion);
+
 		const auto& queueFamilyIndices = m_PhysicalDevice->GetQueueFamilyIndices();
 
 		assert(queueFamilyIndices.GraphicsFamily.has_value());
 		assert(queueFamilyIndices.PresentationFamily.has_value());
 		assert(queueFamilyIndices.TransferFamily.has_value());
+		// every queue submit signals a timeline semaphore
+		assert(IsTimelineSemaphoresEnabled());
+
+		m_Dispatch.vkGetDeviceQueue(device, queueFamilyIndices.GraphicsFamily.value(), 0, &m_GraphicsQueue);
+		m_Dispatch.vkGetDeviceQueue(device, queueFamilyIndices.PresentationFamily.value(), 0, &m_PresentQueue);
+		m_Dispatch.vkGetDeviceQueue(device, queueFamilyIndices.TransferFamily.value(), 0, &m_TransferQueue);
+
+		if (queueFamilyIndices.ComputeFamily.has_value())
+			m_Dispatch.vkGetDeviceQueue(device, queueFamilyIndices.ComputeFamily.value(), 0, &m_ComputeQueue);
+		else
+			m_ComputeQueue = m_GraphicsQueue;
+
+		for (QueueTimeline*& timeline : m_Timelines)
+			timeline = new QueueTimeline(device, m_Dispatch);
+		m_SubmitBatcher = new SubmitBatcher(this);
+
+		if (IsPresentWaitEnabled())
+			assert(m_Dispatch.vkWaitForPresentKHR);
+
+		if (IsHostImageCopyEnabled())
+		{
+			assert(m_Dispatch.vkCopyMemoryToImageEXT && m_Dispatch.vkTransitionImageLayoutEXT);
 
-		vkGetDeviceQueue(device, queueFamilyIndices.GraphicsFamily.value(), 0, &m_GraphicsQueue);
-		vkGetDeviceQueue(device, queueFamilyIndices.PresentationFamily.value(), 0, &m_PresentQueue);
-		vkGetDeviceQueue(device, queueFamilyIndices.TransferFamily.value(), 0, &m_TransferQueue);
+			// the first call gets the counts, the second the layouts
+			VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties{};
+			hostImageCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties.pNext = &hostImageCopyProperties;
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties2(m_PhysicalDevice->GetPhysicalDevice(), &properties);
+
+			m_HostCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+			hostImageCopyProperties.pCopyDstLayouts = m_HostCopyDstLayouts.data();
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties2(m_PhysicalDevice->GetPhysicalDevice(), &properties);
+		}
 	}
 
 	LogicalDevice::~LogicalDevice()
 	{
-		vkDestroyDevice(m_LogicalDevice, nullptr);
+		delete m_SubmitBatcher;
+		for (QueueTimeline* timeline : m_Timelines)
+			delete timeline;
+
+		m_Dispatch.vkDestroyDevice(m_LogicalDevice, nullptr);
 	}
 
 	void LogicalDevice::WaitIdle() const
 	{
-		vkDeviceWaitIdle(m_LogicalDevice);
+		// batched work would otherwise never be waited on
+		m_SubmitBatcher->FlushAll();
+		m_Dispatch.vkDeviceWaitIdle(m_LogicalDevice);
+	}
+
+	VkQueue LogicalDevice::GetQueue(QueueType queue) const
+	{
+		switch (queue)
+		{
+		case QueueType::Graphics: return m_GraphicsQueue;
+		case QueueType::Transfer: return m_TransferQueue;
+		case QueueType::Compute:  return m_ComputeQueue;
+		case QueueType::Count:    break;
+		}
+
+		assert(false);
+		return VK_NULL_HANDLE;
+	}
+
+	uint32_t LogicalDevice::GetQueueFamily(QueueType queue) const
+	{
+		const auto& queueFamilyIndices = m_PhysicalDevice->GetQueueFamilyIndices();
+
+		switch (queue)
+		{
+		case QueueType::Graphics: return queueFamilyIndices.GraphicsFamily.value();
+		case QueueType::Transfer: return queueFamilyIndices.TransferFamily.value();
+		case QueueType::Compute:  
+			return queueFamilyIndices.ComputeFamily.value_or(queueFamilyIndices.GraphicsFamily.value());
+		case QueueType::Count:    break;
+		}
+
+		assert(false);
+		return VK_QUEUE_FAMILY_IGNORED;
+	}
+
+	std::vector<uint32_t> LogicalDevice::GetQueueFamilies() const
+	{
+		std::vector<uint32_t> queueFamilies;
+		for (size_t i = 0; i < static_cast<size_t>(QueueType::Count); i++)
+		{
+			uint32_t queueFamily = GetQueueFamily(static_cast<QueueType>(i));
+			if (std::find(queueFamilies.begin(), queueFamilies.end(), queueFamily) == queueFamilies.end())
+				queueFamilies.push_back(queueFamily);
+		}
+		return queueFamilies;
+	}
+
+	QueueTimeline& LogicalDevice::GetTimeline(QueueType queue) const
+	{
+		return *m_Timelines.at(static_cast<size_t>(queue));
 	}
 
 	void LogicalDevice::QueueSubmit(VkQueue queue, uint32_t submitCount, VkSubmitInfo* submitInfos, VkFence fence)
 	{
-        assert(vkQueueSubmit(queue, submitCount, submitInfos, fence) == VK_SUCCESS);
+        assert(m_Dispatch.vkQueueSubmit(queue, submitCount, submitInfos, fence) == VK_SUCCESS);
 	}
 
 	void LogicalDevice::QueueWaitIdle(VkQueue queue)
 	{
-        assert(vkQueueWaitIdle(queue) == VK_SUCCESS);
+		OPTICK_CATEGORY("QueueWaitIdle", Optick::Category::Wait);
+		m_SubmitBatcher->FlushAll();
+        assert(m_Dispatch.vkQueueWaitIdle(queue) == VK_SUCCESS);
 	}
 
-    void LogicalDevice::SubmitImmediateCommands(const CommandBuffer& commandBuffer, VkQueue queue)
+	VkResult LogicalDevice::WaitForPresent(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout) const
+	{
+		assert(IsPresentWaitEnabled());
+		return m_Dispatch.vkWaitForPresentKHR(m_LogicalDevice, swapchain, presentId, timeout);
+	}
+
+	bool LogicalDevice::SupportsHostImageCopy(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+		VkImageLayout layout) const
+	{
+		// a host transition can't go anywhere else either
+		if (!IsHostImageCopyEnabled() || !CanHostCopyTo(layout))
+			return false;
+
+		VkPhysicalDeviceImageFormatInfo2 formatInfo{};
+		formatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+		formatInfo.format = format;
+		formatInfo.type = VK_IMAGE_TYPE_2D;
+		formatInfo.tiling = tiling;
+		formatInfo.usage = usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+
+		// host access can force a layout that's worse for the gpu
+		VkHostImageCopyDevicePerformanceQueryEXT performanceQuery{};
+		performanceQuery.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT;
+		VkImageFormatProperties2 formatProperties{};
+		formatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+		formatProperties.pNext = &performanceQuery;
+
+		// fails for formats that don't support host transfers
+		VkResult result = RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceImageFormatProperties2(
+			m_PhysicalDevice->GetPhysicalDevice(), &formatInfo, &formatProperties);
+		return result == VK_SUCCESS && performanceQuery.optimalDeviceAccess;
+	}
+
+	bool LogicalDevice::CanHostCopyTo(VkImageLayout layout) const
+	{
+		return std::find(m_HostCopyDstLayouts.begin(), m_HostCopyDstLayouts.end(), layout) != m_HostCopyDstLayouts.end();
+	}
+
+	void LogicalDevice::CopyMemoryToImage(const VkCopyMemoryToImageInfoEXT& copyInfo) const
+	{
+		OPTICK_EVENT();
+		assert(IsHostImageCopyEnabled());
+		assert(m_Dispatch.vkCopyMemoryToImageEXT(m_LogicalDevice, &copyInfo) == VK_SUCCESS);
+	}
+
+	void LogicalDevice::TransitionImageLayout(const VkHostImageLayoutTransitionInfoEXT& transition) const
+	{
+		assert(IsHostImageCopyEnabled());
+		assert(m_Dispatch.vkTransitionImageLayoutEXT(m_LogicalDevice, 1, &transition) == VK_SUCCESS);
+	}
+
+    void LogicalDevice::SubmitImmediateCommands(const CommandBuffer& commandBuffer, QueueType queue)
     {
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer.GetVulkanCommandBuffer();
+        OPTICK_EVENT();
+        QueueSubmission submission;
+        submission.CommandBuffers.push_back(&commandBuffer);
 
-        QueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-        QueueWaitIdle(queue);
+        // unlike waiting for the queue to go idle this doesn't wait for
+        // the frames in flight
+        uint64_t value = Submit(queue, submission);
+        GetTimeline(queue).Wait(value);
     }
+
+	uint64_t LogicalDevice::Submit(QueueType queue, const QueueSubmission& submission)
+	{
+		OPTICK_EVENT();
+		uint64_t value = m_SubmitBatcher->Enqueue(queue, submission);
+		m_SubmitBatcher->Flush(queue);
+		return value;
+	}
+
+	VkSemaphore LogicalDevice::CreateQueueSemaphore(uint64_t initialValue) const
+	{
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeCreateInfo.initialValue = initialValue;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo{};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+		VkSemaphore semaphore;
+		assert(m_Dispatch.vkCreateSemaphore(m_LogicalDevice, &semaphoreCreateInfo, nullptr, &semaphore) == VK_SUCCESS);
+		return semaphore;
+	}
 }
@@ -4,35 +4,111 @@
 #include <vulkan/vulkan.h>
 
 #include "CommandBuffer.h"
+#include "DeviceCapabilities.h"
+#include "QueueOwnership.h"
+#include "QueueTimeline.h"
+#include "VulkanFunctions.h"
+
+#include <array>
+#include <vector>
 
 namespace LearningVulkan 
 {
+    // the value is only used for timeline semaphores
+    struct SemaphoreWait
+    {
+        VkSemaphore Semaphore;
+        VkPipelineStageFlags Stages;
+        uint64_t Value = 0;
+    };
+
+    struct SemaphoreSignal
+    {
+        VkSemaphore Semaphore;
+        uint64_t Value = 0;
+    };
+
+    // Work for one queue, the semaphores order it against work submitted
+    // to the other queues
+    struct QueueSubmission
+    {
+        std::vector<const CommandBuffer*> CommandBuffers;
+        std::vector<SemaphoreWait> Waits;
+        std::vector<SemaphoreSignal> Signals;
+        VkFence Fence = VK_NULL_HANDLE;
+    };
+
     class PhysicalDevice;
+    class SubmitBatcher;
     class LogicalDevice 
     {
     public:
         ~LogicalDevice();
         VkDevice GetVulkanDevice() const { return m_LogicalDevice; }
+        // entry points resolved for this device
+        const DeviceDispatch& GetDispatch() const { return m_Dispatch; }
 
         VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
         VkQueue GetPresentQueue() const { return m_PresentQueue; }
         VkQueue GetTransferQueue() const { return m_TransferQueue; }
+        // the graphics queue if the device has no compute family of its own
+        VkQueue GetComputeQueue() const { return m_ComputeQueue; }
+        VkQueue GetQueue(QueueType queue) const;
+        uint32_t GetQueueFamily(QueueType queue) const;
+        // the distinct families of all queue types, for concurrent sharing
+        std::vector<uint32_t> GetQueueFamilies() const;
+        // both flush the work batched for every queue first
         void WaitIdle() const;
         PhysicalDevice* GetPhysicalDevice() const { return m_PhysicalDevice; }
         void QueueSubmit(VkQueue queue, uint32_t submitCount, VkSubmitInfo* submitInfos, VkFence fence);
         void QueueWaitIdle(VkQueue queue);
-        void SubmitImmediateCommands(const CommandBuffer& commandBuffer, VkQueue queue);
+        // submits and waits for just this submit on the host
+        void SubmitImmediateCommands(const CommandBuffer& commandBuffer, QueueType queue);
+        // submits right away together with the work batched for the queue,
+        // returns the value the queue's timeline reaches once the work is
+        // done, which can be waited on or polled through GetTimeline
+        uint64_t Submit(QueueType queue, const QueueSubmission& submission);
+        QueueTimeline& GetTimeline(QueueType queue) const;
+        // every submit goes through the batcher
+        SubmitBatcher& GetSubmitBatcher() const { return *m_SubmitBatcher; }
+
+        // a timeline semaphore for ordering work between queues
+        VkSemaphore CreateQueueSemaphore(uint64_t initialValue = 0) const;
+
+        // the versions and optional features the device was created with
+        const DeviceCapabilities& GetCapabilities() const { return m_Capabilities; }
+        bool IsPresentWaitEnabled() const { return m_Capabilities.Features.PresentWait; }
+        bool IsMemoryBudgetEnabled() const { return m_Capabilities.Features.MemoryBudget; }
+        bool IsTimelineSemaphoresEnabled() const { return m_Capabilities.Features.TimelineSemaphores; }
+        VkResult WaitForPresent(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout) const;
+
+        bool IsHostImageCopyEnabled() const { return m_Capabilities.Features.HostImageCopy; }
+        // true when the cpu can write images of the format without making
+        // device access to them slower and leave them in the layout
+        bool SupportsHostImageCopy(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+            VkImageLayout layout) const;
+        // whether host copies and transitions can target the layout
+        bool CanHostCopyTo(VkImageLayout layout) const;
+        void CopyMemoryToImage(const VkCopyMemoryToImageInfoEXT& copyInfo) const;
+        void TransitionImageLayout(const VkHostImageLayoutTransitionInfoEXT& transition) const;
 
     private:
-        LogicalDevice(VkDevice device, PhysicalDevice* physicalDevice);
+        LogicalDevice(VkDevice device, PhysicalDevice* physicalDevice, const DeviceCapabilities& capabilities);
 
     private:
         VkDevice m_LogicalDevice = VK_NULL_HANDLE;
+        DeviceDispatch m_Dispatch;
         VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
         VkQueue m_PresentQueue = VK_NULL_HANDLE;
         VkQueue m_TransferQueue = VK_NULL_HANDLE;
+        VkQueue m_ComputeQueue = VK_NULL_HANDLE;
+        std::array<QueueTimeline*, static_cast<size_t>(QueueType::Count)> m_Timelines;
+        SubmitBatcher* m_SubmitBatcher = nullptr;
         PhysicalDevice* m_PhysicalDevice = nullptr;
 
+        DeviceCapabilities m_Capabilities;
+        std::vector<VkImageLayout> m_HostCopyDstLayouts;
+
         friend class PhysicalDevice;
     };
 }
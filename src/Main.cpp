@@ -1,9 +1,26 @@
 #include "Application.h"
+#include "JobSystemBenchmark.h"
+#include "PhysicalDevice.h"
+
+#include <string_view>
 
 using namespace LearningVulkan;
 
 int main(int argc, char** argv) 
 {
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--benchmark-jobs")
+        {
+            RunJobSystemBenchmark();
+            return 0;
+        }
+
+        // --device <name or uuid>
+        if (std::string_view(argv[i]) == "--device" && i + 1 < argc)
+            PhysicalDevice::SetDeviceOverride(argv[++i]);
+    }
+
     Application* application = new Application();
 
     application->Run();
@@ -0,0 +1,324 @@
+#include "MemoryTracker.h"
+#include "RendererContext.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // without VK_EXT_memory_budget we assume we can use this much of 
+        // a heap, the rest is left to other processes and the driver
+        constexpr float DefaultBudgetFraction = 0.8f;
+        // warn once a heap's usage gets this close to its budget
+        constexpr float BudgetWarningFraction = 0.9f;
+
+        size_t ToIndex(MemoryCategory category)
+        {
+            return static_cast<size_t>(category);
+        }
+
+        uint32_t ToBit(MemoryStrategy strategy)
+        {
+            return 1u << static_cast<uint32_t>(strategy);
+        }
+
+        const char* ToString(MemoryStrategy strategy)
+        {
+            switch (strategy)
+            {
+            case MemoryStrategy::DeviceOnly: return "Device only";
+            case MemoryStrategy::Upload: return "Upload";
+            case MemoryStrategy::Readback: return "Readback";
+            case MemoryStrategy::DeviceLocalMappable: 
+                return "Device local mappable";
+            default: return "Unknown";
+            }
+        }
+    }
+
+    MemoryTracker::MemoryTracker(VkPhysicalDevice physicalDevice,
+                                 bool budgetEnabled)
+        : m_PhysicalDevice(physicalDevice), m_BudgetEnabled(budgetEnabled)
+    {
+        RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice,
+                                            &m_MemoryProperties);
+
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+        {
+            const VkMemoryHeap& heap = m_MemoryProperties.memoryHeaps[i];
+            m_Heaps[i].Size = heap.size;
+            m_Heaps[i].Budget = static_cast<VkDeviceSize>(
+                                    heap.size * DefaultBudgetFraction);
+            m_Heaps[i].DeviceLocal = 
+                            heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        }
+
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+        {
+            VkMemoryPropertyFlags flags = 
+                            m_MemoryProperties.memoryTypes[i].propertyFlags;
+            bool deviceLocal = flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            bool mappable = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+                            (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            if (deviceLocal)
+                m_TypeStrategies[i] |= ToBit(MemoryStrategy::DeviceOnly);
+            if (mappable)
+            {
+                m_TypeStrategies[i] |= ToBit(MemoryStrategy::Upload) |
+                                       ToBit(MemoryStrategy::Readback);
+                m_HasCachedReadback |= 
+                            flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            }
+            if (deviceLocal && mappable)
+                m_TypeStrategies[i] |= 
+                            ToBit(MemoryStrategy::DeviceLocalMappable);
+        }
+
+        Update();
+    }
+
+    uint32_t MemoryTracker::FindMemoryType(uint32_t memoryMask,
+                                           VkMemoryPropertyFlags properties,
+                                           VkDeviceSize size)
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        int32_t memoryType = TryFindMemoryType(memoryMask, properties, size,
+                                               true);
+        if (memoryType >= 0)
+            return memoryType;
+
+        // slower memory is better than the driver paging our
+        // resources in and out every frame
+        if (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        {
+            memoryType = TryFindMemoryType(memoryMask,
+                properties & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, 
+                true);
+            if (memoryType >= 0)
+                return memoryType;
+        }
+
+        // every heap is over budget, let the driver deal with it
+        memoryType = TryFindMemoryType(memoryMask, properties, size, false);
+        assert(memoryType >= 0);
+        return memoryType;
+    }
+
+    VkMemoryPropertyFlags MemoryTracker::GetMemoryProperties(
+        MemoryStrategy strategy) const
+    {
+        constexpr VkMemoryPropertyFlags Mappable = 
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        switch (strategy)
+        {
+        case MemoryStrategy::DeviceOnly:
+            return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        case MemoryStrategy::Upload:
+            return Mappable;
+        case MemoryStrategy::Readback:
+            // uncached reads are very slow
+            return m_HasCachedReadback 
+                    ? Mappable | VK_MEMORY_PROPERTY_HOST_CACHED_BIT 
+                    : Mappable;
+        case MemoryStrategy::DeviceLocalMappable:
+            return Mappable | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        default:
+            assert(false);
+            return 0;
+        }
+    }
+
+    bool MemoryTracker::CanUse(MemoryStrategy strategy, 
+                               VkDeviceSize size, uint32_t memoryMask) const
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+        {
+            if ((memoryMask & (1 << i)) &&
+                (m_TypeStrategies[i] & ToBit(strategy)) &&
+                HasRoom(m_MemoryProperties.memoryTypes[i].heapIndex, size))
+                return true;
+        }
+
+        return false;
+    }
+
+    void MemoryTracker::PrintMemoryStrategies() const
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        std::cout << "Memory strategies:\n";
+        for (uint32_t s = 0; s < static_cast<uint32_t>(MemoryStrategy::Count);
+             s++)
+        {
+            MemoryStrategy strategy = static_cast<MemoryStrategy>(s);
+            std::cout << '\t' << ToString(strategy) << ":";
+
+            bool found = false;
+            for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+            {
+                if (!(m_TypeStrategies[i] & ToBit(strategy)))
+                    continue;
+
+                uint32_t heap = m_MemoryProperties.memoryTypes[i].heapIndex;
+                std::cout << " type " << i << " (heap " << heap << ", " 
+                          << (m_Heaps[heap].Size >> 20) << "MB)";
+                found = true;
+            }
+
+            std::cout << (found ? "\n" : " none\n");
+        }
+    }
+
+    int32_t MemoryTracker::TryFindMemoryType(
+        uint32_t memoryMask, VkMemoryPropertyFlags properties,
+        VkDeviceSize size, bool requireRoom) const
+    {
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+        {
+            const VkMemoryType& type = m_MemoryProperties.memoryTypes[i];
+            if (!(memoryMask & (1 << i)) || 
+                (type.propertyFlags & properties) != properties)
+                continue;
+
+            if (!requireRoom || HasRoom(type.heapIndex, size))
+                return i;
+        }
+
+        return -1;
+    }
+
+    bool MemoryTracker::HasRoom(uint32_t heap, VkDeviceSize size) const
+    {
+        return m_Heaps[heap].GetHeadroom() >= size;
+    }
+
+    void MemoryTracker::TrackAllocation(VkDeviceMemory memory, 
+                                        VkDeviceSize size,
+                                        uint32_t memoryType,
+                                        MemoryCategory category)
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        uint32_t heap = m_MemoryProperties.memoryTypes[memoryType].heapIndex;
+        m_Allocations[memory] = { size, heap, category };
+
+        MemoryHeapStatistics& statistics = m_Heaps[heap];
+        statistics.Allocated += size;
+        statistics.PeakAllocated = std::max(statistics.PeakAllocated,
+                                            statistics.Allocated);
+        // the driver's numbers only get refreshed by Update
+        statistics.Usage += size;
+
+        VkDeviceSize& categoryUsage = m_CategoryUsage[ToIndex(category)];
+        categoryUsage += size;
+        m_CategoryPeak[ToIndex(category)] = std::max(
+                            m_CategoryPeak[ToIndex(category)], categoryUsage);
+    }
+
+    void MemoryTracker::TrackFree(VkDeviceMemory memory)
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        auto it = m_Allocations.find(memory);
+        assert(it != m_Allocations.end());
+
+        const Allocation& allocation = it->second;
+        MemoryHeapStatistics& statistics = m_Heaps[allocation.Heap];
+        statistics.Allocated -= allocation.Size;
+        statistics.Usage -= std::min(statistics.Usage, allocation.Size);
+        m_CategoryUsage[ToIndex(allocation.Category)] -= allocation.Size;
+
+        m_Allocations.erase(it);
+    }
+
+    void MemoryTracker::Update()
+    {
+        OPTICK_EVENT();
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = 
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        if (m_BudgetEnabled)
+        {
+            VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+            memoryProperties.sType = 
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            memoryProperties.pNext = &budgetProperties;
+            RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, 
+                                                 &memoryProperties);
+        }
+
+        std::scoped_lock lock(m_Mutex);
+
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+        {
+            MemoryHeapStatistics& statistics = m_Heaps[i];
+            if (m_BudgetEnabled)
+            {
+                statistics.Budget = budgetProperties.heapBudget[i];
+                statistics.Usage = budgetProperties.heapUsage[i];
+            }
+            else
+            {
+                statistics.Usage = statistics.Allocated;
+            }
+
+            OPTICK_TAG("Heap", i);
+            OPTICK_TAG("UsageMB", statistics.Usage >> 20);
+            OPTICK_TAG("BudgetMB", statistics.Budget >> 20);
+
+            bool overBudget = statistics.Usage > 
+                                statistics.Budget * BudgetWarningFraction;
+            if (overBudget && !(m_OverBudgetHeaps & (1 << i)))
+            {
+                std::cout << "Memory heap " << i << " is close to its "
+                          << "budget: " << (statistics.Usage >> 20) 
+                          << "MB of " << (statistics.Budget >> 20) 
+                          << "MB used\n";
+            }
+
+            if (overBudget)
+                m_OverBudgetHeaps |= 1 << i;
+            else
+                m_OverBudgetHeaps &= ~(1 << i);
+        }
+    }
+
+    uint32_t MemoryTracker::GetHeapCount() const
+    {
+        return m_MemoryProperties.memoryHeapCount;
+    }
+
+    MemoryHeapStatistics MemoryTracker::GetHeapStatistics(uint32_t heap) const
+    {
+        assert(heap < m_MemoryProperties.memoryHeapCount);
+        std::scoped_lock lock(m_Mutex);
+        return m_Heaps[heap];
+    }
+
+    VkDeviceSize MemoryTracker::GetCategoryUsage(
+        MemoryCategory category) const
+    {
+        std::scoped_lock lock(m_Mutex);
+        return m_CategoryUsage[ToIndex(category)];
+    }
+
+    VkDeviceSize MemoryTracker::GetCategoryPeak(
+        MemoryCategory category) const
+    {
+        std::scoped_lock lock(m_Mutex);
+        return m_CategoryPeak[ToIndex(category)];
+    }
+}
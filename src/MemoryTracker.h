@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace LearningVulkan
+{
+    enum class MemoryCategory
+    {
+        Vertex,
+        Index,
+        Uniform,
+        Texture,
+        Staging,
+        Attachment,
+        Count,
+    };
+
+    // How the cpu and gpu use a resource's memory
+    enum class MemoryStrategy
+    {
+        // only touched by the gpu
+        DeviceOnly,
+        // written by the cpu and read by the gpu, e.g. staging buffers
+        Upload,
+        // written by the gpu and read back by the cpu
+        Readback,
+        // device local memory the cpu can write to directly, all of vram 
+        // with resizable bar, a small window of it without, and usually 
+        // everything on integrated gpus
+        DeviceLocalMappable,
+        Count,
+    };
+
+    struct MemoryHeapStatistics
+    {
+        VkDeviceSize Size = 0;
+        // how much the process can use before the driver starts evicting
+        // or failing allocations
+        VkDeviceSize Budget = 0;
+        // what the driver reports for the whole process, falls back to
+        // our own allocations without VK_EXT_memory_budget
+        VkDeviceSize Usage = 0;
+        // allocations made through the tracker
+        VkDeviceSize Allocated = 0;
+        VkDeviceSize PeakAllocated = 0;
+        bool DeviceLocal = false;
+
+        VkDeviceSize GetHeadroom() const
+        {
+            return Budget > Usage ? Budget - Usage : 0;
+        }
+    };
+
+    // Accounts for every device memory allocation by category and heap 
+    // and keeps track of how close each heap is to its budget.
+    // NOTE: can be used from any thread
+    class MemoryTracker
+    {
+    public:
+        MemoryTracker(VkPhysicalDevice physicalDevice, bool budgetEnabled);
+
+        MemoryTracker(const MemoryTracker& other) = delete;
+        MemoryTracker& operator=(const MemoryTracker& other) = delete;
+
+        // picks a memory type with the properties, preferring heaps that 
+        // still have room for the allocation. Once every device local 
+        // heap is over budget device local memory falls back to any 
+        // compatible type instead of making the driver evict
+        uint32_t FindMemoryType(uint32_t memoryMask,
+                                VkMemoryPropertyFlags properties,
+                                VkDeviceSize size);
+
+        // the properties to allocate with for a strategy
+        VkMemoryPropertyFlags GetMemoryProperties(
+            MemoryStrategy strategy) const;
+        // true if a memory type for the strategy is in the mask and its
+        // heap has room for the size, used to skip staging when memory is
+        // mappable
+        bool CanUse(MemoryStrategy strategy, VkDeviceSize size,
+                    uint32_t memoryMask) const;
+        void PrintMemoryStrategies() const;
+
+        void TrackAllocation(VkDeviceMemory memory, VkDeviceSize size,
+                             uint32_t memoryType, MemoryCategory category);
+        void TrackFree(VkDeviceMemory memory);
+
+        // refreshes the budgets, called once per frame
+        void Update();
+
+        uint32_t GetHeapCount() const;
+        MemoryHeapStatistics GetHeapStatistics(uint32_t heap) const;
+        VkDeviceSize GetCategoryUsage(MemoryCategory category) const;
+        VkDeviceSize GetCategoryPeak(MemoryCategory category) const;
+
+    private:
+        struct Allocation
+        {
+            VkDeviceSize Size;
+            uint32_t Heap;
+            MemoryCategory Category;
+        };
+
+        bool HasRoom(uint32_t heap, VkDeviceSize size) const;
+        // returns -1 if there's no matching type
+        int32_t TryFindMemoryType(uint32_t memoryMask,
+                                  VkMemoryPropertyFlags properties,
+                                  VkDeviceSize size, bool requireRoom) const;
+
+    private:
+        VkPhysicalDevice m_PhysicalDevice;
+        bool m_BudgetEnabled;
+        VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+        // the strategies each memory type can serve, as bit masks
+        std::array<uint32_t, VK_MAX_MEMORY_TYPES> m_TypeStrategies{};
+        bool m_HasCachedReadback = false;
+
+        mutable std::mutex m_Mutex;
+        std::array<MemoryHeapStatistics, VK_MAX_MEMORY_HEAPS> m_Heaps{};
+        std::array<VkDeviceSize, 
+            static_cast<size_t>(MemoryCategory::Count)> m_CategoryUsage{};
+        std::array<VkDeviceSize, 
+            static_cast<size_t>(MemoryCategory::Count)> m_CategoryPeak{};
+        std::unordered_map<VkDeviceMemory, Allocation> m_Allocations;
+        // heaps we already warned about, cleared once they recover
+        uint32_t m_OverBudgetHeaps = 0;
+    };
+}
@@ -1,41 +1,53 @@
 #include "PhysicalDevice.h"
+#include "RendererContext.h"
 #include "VulkanUtils.h"
 #include "Application.h"
 
 #include <vector>
 #include <cassert>
-#include <map>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <set>
 #include <string>
 
 namespace LearningVulkan
 {
+	std::string PhysicalDevice::m_DeviceOverride;
+
 	PhysicalDevice::PhysicalDevice(VkPhysicalDevice physicalDevice)
 		: m_PhysicalDevice(physicalDevice)
-	{ }
+	{
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_Properties);
+	}
 
-	LogicalDevice* PhysicalDevice::CreateLogicalDevice()
+	LogicalDevice* PhysicalDevice::CreateLogicalDevice(const DeviceFeatures& requestedFeatures)
 	{
 		m_QueueFamilyIndices = FindQueueFamilyIndices(m_PhysicalDevice);
 
-		VkDeviceQueueCreateInfo graphicsQueueCreateInfo{};
-		graphicsQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		graphicsQueueCreateInfo.queueFamilyIndex = m_QueueFamilyIndices.GraphicsFamily.value();
-		graphicsQueueCreateInfo.queueCount = 1;
-		float queuePriority = 1.0f;
-		graphicsQueueCreateInfo.pQueuePriorities = &queuePriority;
-
-		VkDeviceQueueCreateInfo transferQueueCreateInfo{};
-		transferQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		transferQueueCreateInfo.queueFamilyIndex = m_QueueFamilyIndices.TransferFamily.value();
-		transferQueueCreateInfo.queueCount = 1;
-		transferQueueCreateInfo.pQueuePriorities = &queuePriority;
+		PrintQueueTopology();
 
-		std::array queueCreateInfos = {
-			graphicsQueueCreateInfo,
-			transferQueueCreateInfo,
+		// a family may only appear once in the create infos
+		std::set<uint32_t> uniqueQueueFamilies = {
+			m_QueueFamilyIndices.GraphicsFamily.value(),
+			m_QueueFamilyIndices.PresentationFamily.value(),
+			m_QueueFamilyIndices.TransferFamily.value(),
 		};
+		if (m_QueueFamilyIndices.ComputeFamily.has_value())
+			uniqueQueueFamilies.insert(m_QueueFamilyIndices.ComputeFamily.value());
+
+		float queuePriority = 1.0f;
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		for (uint32_t queueFamily : uniqueQueueFamilies)
+		{
+			VkDeviceQueueCreateInfo queueCreateInfo{};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueFamilyIndex = queueFamily;
+			queueCreateInfo.queueCount = 1;
+			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfos.push_back(queueCreateInfo);
+		}
 
 		VkDeviceCreateInfo deviceCreateInfo{};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -46,83 +58,223 @@ namespace LearningVulkan
 		deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-		deviceCreateInfo.enabledExtensionCount = VulkanUtils::DeviceExtensionsSize;
-		deviceCreateInfo.ppEnabledExtensionNames = VulkanUtils::DeviceExtensions.data();
+		DeviceFeatureNegotiator negotiator(m_PhysicalDevice, RendererContext::GetInstanceVersion());
+		DeviceCapabilities capabilities = negotiator.Negotiate(requestedFeatures);
+		const std::vector<const char*>& extensions = negotiator.GetExtensions();
 
-		VkPhysicalDeviceFeatures features{};
-		features.samplerAnisotropy = VK_TRUE;
+		deviceCreateInfo.enabledExtensionCount = extensions.size();
+		deviceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
-		deviceCreateInfo.pEnabledFeatures = &features;
+		// the features are passed through the pNext chain instead
+		deviceCreateInfo.pNext = negotiator.GetFeatureChain();
+		deviceCreateInfo.pEnabledFeatures = nullptr;
+
+		capabilities.Print();
 
 		VkDevice device;
-		assert(vkCreateDevice(m_PhysicalDevice, &deviceCreateInfo, nullptr, &device) == VK_SUCCESS);	
-		return new LogicalDevice(device, this);
+		assert(RendererContext::GetInstanceDispatch().vkCreateDevice(m_PhysicalDevice, &deviceCreateInfo, nullptr, &device) == VK_SUCCESS);	
+		return new LogicalDevice(device, this, capabilities);
 	}
 
 	QueueFamilyIndices PhysicalDevice::FindQueueFamilyIndices(VkPhysicalDevice physicalDevice)
 	{
 		QueueFamilyIndices queueFamilyIndices;
 		uint32_t queueFamilyPropertiesCount;
-		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, nullptr);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, nullptr);
 		std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyPropertiesCount);
-		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
 
-		uint32_t index = 0;
-		for (const auto& properties : queueFamilyProperties) 
+		auto supportsPresentation = [&](uint32_t index)
 		{
-			if (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			VkBool32 presentationSupported;
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, index, RendererContext::GetVulkanSurface(), &presentationSupported);
+			return presentationSupported == VK_TRUE;
+		};
+
+		auto findFamily = [&](VkQueueFlags required, VkQueueFlags excluded) -> std::optional<uint32_t>
+		{
+			for (uint32_t index = 0; index < queueFamilyPropertiesCount; index++)
+			{
+				VkQueueFlags flags = queueFamilyProperties[index].queueFlags;
+				if ((flags & required) == required && !(flags & excluded))
+					return index;
+			}
+			return std::nullopt;
+		};
+
+		// prefer a graphics family that can also present so the swapchain 
+		// images never change owner
+		for (uint32_t index = 0; index < queueFamilyPropertiesCount; index++)
+		{
+			if (!(queueFamilyProperties[index].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+				continue;
+
+			if (!queueFamilyIndices.GraphicsFamily.has_value())
 				queueFamilyIndices.GraphicsFamily = index;
-			else if (properties.queueFlags & VK_QUEUE_TRANSFER_BIT)
-				queueFamilyIndices.TransferFamily = index;
 
-			VkBool32 presentationSupported;
-			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, index, RendererContext::GetVulkanSurface(), &presentationSupported);
-			if (presentationSupported)
+			if (supportsPresentation(index))
+			{
+				queueFamilyIndices.GraphicsFamily = index;
 				queueFamilyIndices.PresentationFamily = index;
-
-			if (queueFamilyIndices.IsComplete())
 				break;
+			}
+		}
 
-			index++;
+		if (!queueFamilyIndices.PresentationFamily.has_value())
+		{
+			for (uint32_t index = 0; index < queueFamilyPropertiesCount; index++)
+			{
+				if (supportsPresentation(index))
+				{
+					queueFamilyIndices.PresentationFamily = index;
+					break;
+				}
+			}
 		}
 
+		if (!queueFamilyIndices.GraphicsFamily.has_value())
+			return queueFamilyIndices;
+
+		// a transfer only family usually maps to the copy engines and runs
+		// alongside graphics, graphics families always support transfers
+		queueFamilyIndices.TransferFamily = findFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+		if (!queueFamilyIndices.TransferFamily.has_value())
+			queueFamilyIndices.TransferFamily = findFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT);
+		if (!queueFamilyIndices.TransferFamily.has_value())
+			queueFamilyIndices.TransferFamily = queueFamilyIndices.GraphicsFamily;
+
+		queueFamilyIndices.ComputeFamily = findFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+		if (!queueFamilyIndices.ComputeFamily.has_value() && 
+			queueFamilyProperties[queueFamilyIndices.GraphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)
+			queueFamilyIndices.ComputeFamily = queueFamilyIndices.GraphicsFamily;
+
 		return queueFamilyIndices;
 	}
 
-	uint32_t PhysicalDevice::RateDeviceSuitability(VkPhysicalDevice physicalDevice)
+	void PhysicalDevice::PrintQueueTopology() const
+	{
+		uint32_t queueFamilyPropertiesCount;
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyPropertiesCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyPropertiesCount);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
+
+		std::cout << "Queue families:\n";
+		for (uint32_t index = 0; index < queueFamilyPropertiesCount; index++)
+		{
+			const VkQueueFamilyProperties& properties = queueFamilyProperties[index];
+			std::cout << '\t' << index << ": " << properties.queueCount << " queue(s),";
+			if (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+				std::cout << " graphics";
+			if (properties.queueFlags & VK_QUEUE_COMPUTE_BIT)
+				std::cout << " compute";
+			if (properties.queueFlags & VK_QUEUE_TRANSFER_BIT)
+				std::cout << " transfer";
+			if (properties.queueFlags & VK_QUEUE_SPARSE_BINDING_BIT)
+				std::cout << " sparse";
+			std::cout << '\n';
+		}
+
+		const QueueFamilyIndices& indices = m_QueueFamilyIndices;
+		std::cout << "Picked queue families: graphics " << indices.GraphicsFamily.value()
+				  << ", present " << indices.PresentationFamily.value()
+				  << ", transfer " << indices.TransferFamily.value()
+				  << (indices.HasAsyncTransfer() ? " (async)" : "");
+		if (indices.ComputeFamily.has_value())
+			std::cout << ", compute " << indices.ComputeFamily.value()
+					  << (indices.HasAsyncCompute() ? " (async)" : "");
+		std::cout << '\n';
+	}
+
+	DeviceRating PhysicalDevice::RateDeviceSuitability(VkPhysicalDevice physicalDevice)
 	{
 		VkPhysicalDeviceProperties deviceProperties;
-		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+		DeviceRating rating;
+
+		switch (deviceProperties.deviceType)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   rating.TypeRank = 4; break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: rating.TypeRank = 3; break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    rating.TypeRank = 2; break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:            rating.TypeRank = 1; break;
+		default:                                     rating.TypeRank = 0; break;
+		}
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+				rating.DeviceLocalMemory += memoryProperties.memoryHeaps[i].size;
+		}
+
+		// feature negotiation needs vkGetPhysicalDeviceFeatures2
+		rating.Suitable = deviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+						  FindQueueFamilyIndices(physicalDevice).IsComplete() &&
+						  CheckDeviceExtensionSupport(physicalDevice);
+
+		if (rating.Suitable)
+		{
+			DeviceFeatureNegotiator negotiator(physicalDevice, RendererContext::GetInstanceVersion());
+			const DeviceFeatures& features = negotiator.GetSupported().Features;
+			// queue submits are tracked with timeline semaphores
+			rating.Suitable = features.SamplerAnisotropy && features.TimelineSemaphores;
+			rating.OptionalFeatureCount = features.GetCount();
+		}
+
+		std::cout << '\t' << "Name: " << deviceProperties.deviceName 
+				  << "; Type rank: " << rating.TypeRank
+				  << "; Device local memory: " << rating.DeviceLocalMemory / (1024 * 1024) << " MiB"
+				  << "; Optional features: " << rating.OptionalFeatureCount
+				  << (rating.Suitable ? "" : "; Unsuitable") << '\n';
+		return rating;
+	}
 
-		uint32_t score = 1;
+	bool PhysicalDevice::MatchesDeviceOverride(VkPhysicalDevice physicalDevice, std::string_view deviceOverride)
+	{
+		VkPhysicalDeviceIDProperties idProperties{};
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
 
-		if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-			score++;
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &idProperties;
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
 
-		const QueueFamilyIndices& queueFamilyIndices = FindQueueFamilyIndices(physicalDevice);
-		if (!queueFamilyIndices.IsComplete())
-			score = 0;
+		auto toLower = [](std::string_view text)
+		{
+			std::string lower(text);
+			for (char& c : lower)
+				c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			return lower;
+		};
 
-		if (!CheckDeviceExtensionSupport(physicalDevice))
-			score = 0;
+		// the uuid can be given with or without dashes
+		std::string uuidOverride;
+		for (char c : toLower(deviceOverride))
+		{
+			if (c != '-')
+				uuidOverride.push_back(c);
+		}
 
-		VkPhysicalDeviceFeatures deviceFeatures;
-		vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
-		if (deviceFeatures.samplerAnisotropy == VK_FALSE)
-			score = 0;
+		char uuid[VK_UUID_SIZE * 2 + 1];
+		for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+			std::snprintf(uuid + i * 2, 3, "%02x", idProperties.deviceUUID[i]);
 
-		std::cout << '\t' << "Name: " << deviceProperties.deviceName << "; Score: " << score << '\n';
-		return score;
+		if (uuidOverride == uuid)
+			return true;
+
+		return toLower(properties.properties.deviceName).find(toLower(deviceOverride)) != std::string::npos;
 	}
 
 	bool PhysicalDevice::CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
 	{
 		uint32_t extensionCount = 0;
 
-		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		RendererContext::GetInstanceDispatch().vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
 
 		std::vector<VkExtensionProperties> extensionProperties(extensionCount);
-		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data());
+		RendererContext::GetInstanceDispatch().vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data());
 
 		std::set<std::string> requiredExtensions(VulkanUtils::DeviceExtensions.begin(), VulkanUtils::DeviceExtensions.end());
 
@@ -138,40 +290,32 @@ namespace LearningVulkan
 
 		VkSurfaceKHR surface = RendererContext::GetVulkanSurface();
 
-		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice, surface, &swapChainSupport.SurfaceCapabilities);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice, surface, &swapChainSupport.SurfaceCapabilities);
 
 		uint32_t formatCount = 0;
-		vkGetPhysicalDeviceSurfaceFormatsKHR(m_PhysicalDevice, surface, &formatCount, nullptr);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfaceFormatsKHR(m_PhysicalDevice, surface, &formatCount, nullptr);
 
 		if (formatCount > 0)
 		{
 			swapChainSupport.SurfaceFormats.resize(formatCount);
-			vkGetPhysicalDeviceSurfaceFormatsKHR(m_PhysicalDevice, surface, &formatCount, swapChainSupport.SurfaceFormats.data());
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfaceFormatsKHR(m_PhysicalDevice, surface, &formatCount, swapChainSupport.SurfaceFormats.data());
 		}
 
 		uint32_t presentModesCount = 0;
-		vkGetPhysicalDeviceSurfacePresentModesKHR(m_PhysicalDevice, surface, &presentModesCount, nullptr);
+		RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfacePresentModesKHR(m_PhysicalDevice, surface, &presentModesCount, nullptr);
 
 		if (presentModesCount > 0)
 		{
 			swapChainSupport.PresentModes.resize(presentModesCount);
-			vkGetPhysicalDeviceSurfacePresentModesKHR(m_PhysicalDevice, surface, &presentModesCount, swapChainSupport.PresentModes.data());
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceSurfacePresentModesKHR(m_PhysicalDevice, surface, &presentModesCount, swapChainSupport.PresentModes.data());
 		}
 
 		return swapChainSupport;
 	}
 
-	uint32_t PhysicalDevice::FindMemoryType(uint32_t memoryMask, VkMemoryPropertyFlags properties)
+	void PhysicalDevice::SetDeviceOverride(std::string_view device)
 	{
-		VkPhysicalDeviceMemoryProperties memoryProperties;
-		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
-
-		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
-			if (memoryMask & (1 << i) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-				return i;
-
-		assert(false);
-		return 0;
+		m_DeviceOverride = device;
 	}
 
 	PhysicalDevice* PhysicalDevice::GetSuitablePhysicalDevice()
@@ -179,27 +323,57 @@ namespace LearningVulkan
 		uint32_t physicalDeviceCount = 0;
 		VkInstance instance = RendererContext::GetVulkanInstance();
 
-		vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+		RendererContext::GetInstanceDispatch().vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
 
 		assert(physicalDeviceCount > 0);
 
 		std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-		vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
+		RendererContext::GetInstanceDispatch().vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
 
-		std::multimap<uint32_t, VkPhysicalDevice> deviceCandidates;
+		std::vector<DeviceRating> ratings;
 
 		std::cout << "Available devices:\n";
 		for (const auto& physicalDevice : physicalDevices)
+			ratings.push_back(RateDeviceSuitability(physicalDevice));
+
+		std::string deviceOverride = m_DeviceOverride;
+		if (deviceOverride.empty())
+		{
+			if (const char* environmentOverride = std::getenv("LEARNING_VULKAN_DEVICE"))
+				deviceOverride = environmentOverride;
+		}
+
+		std::optional<size_t> picked;
+
+		if (!deviceOverride.empty())
+		{
+			for (size_t i = 0; i < physicalDevices.size(); i++)
+			{
+				if (ratings[i].Suitable && MatchesDeviceOverride(physicalDevices[i], deviceOverride))
+				{
+					picked = i;
+					break;
+				}
+			}
+
+			if (!picked.has_value())
+				std::cerr << "No suitable device matches \"" << deviceOverride << "\", picking the best one instead\n";
+		}
+
+		if (!picked.has_value())
 		{
-			uint32_t score = RateDeviceSuitability(physicalDevice);
-			deviceCandidates.insert(std::make_pair(score, physicalDevice));
+			for (size_t i = 0; i < physicalDevices.size(); i++)
+			{
+				if (ratings[i].Suitable && (!picked.has_value() || ratings[i] > ratings[picked.value()]))
+					picked = i;
+			}
 		}
 
-		if (deviceCandidates.rbegin()->first > 0)
+		if (picked.has_value())
 		{
-			VkPhysicalDevice vulkanPhysicalDevice = deviceCandidates.rbegin()->second;
+			VkPhysicalDevice vulkanPhysicalDevice = physicalDevices[picked.value()];
 			VkPhysicalDeviceProperties deviceProperties;
-			vkGetPhysicalDeviceProperties(vulkanPhysicalDevice, &deviceProperties);
+			RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties(vulkanPhysicalDevice, &deviceProperties);
 			std::cout << "Picked device: " << deviceProperties.deviceName << '\n';
 
 			PhysicalDevice* physicalDevice = new PhysicalDevice(vulkanPhysicalDevice);
@@ -1,19 +1,39 @@
 #pragma once
 
 #include "LogicalDevice.h"
+#include "DeviceCapabilities.h"
 
 #include <vulkan/vulkan.h>
 
+#include <compare>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
 namespace LearningVulkan 
 {
+    // Transfer and compute fall back to the graphics family when the device
+    // has no dedicated family for them
     struct QueueFamilyIndices 
     {
-        std::optional<uint32_t> GraphicsFamily, PresentationFamily, TransferFamily;
+        std::optional<uint32_t> GraphicsFamily, PresentationFamily, TransferFamily, ComputeFamily;
         bool IsComplete() const { return GraphicsFamily.has_value() && PresentationFamily.has_value() && TransferFamily.has_value(); }
+        bool HasAsyncTransfer() const { return TransferFamily != GraphicsFamily; }
+        bool HasAsyncCompute() const { return ComputeFamily.has_value() && ComputeFamily != GraphicsFamily; }
+    };
+
+    // Compared in member order, so the device type outweighs the memory
+    // size which outweighs the feature count
+    struct DeviceRating
+    {
+        bool Suitable = false;
+        uint32_t TypeRank = 0;
+        VkDeviceSize DeviceLocalMemory = 0;
+        uint32_t OptionalFeatureCount = 0;
+
+        auto operator<=>(const DeviceRating& other) const = default;
     };
 
     struct SwapchainSupportDetails
@@ -30,22 +50,32 @@ namespace LearningVulkan
         ~PhysicalDevice() = default;
 
         static PhysicalDevice* GetSuitablePhysicalDevice();
+        // name substring or uuid of the device to use, takes precedence over
+        // the LEARNING_VULKAN_DEVICE environment variable
+        static void SetDeviceOverride(std::string_view device);
 
         const QueueFamilyIndices& GetQueueFamilyIndices() const { return m_QueueFamilyIndices; }
         VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
+        const VkPhysicalDeviceProperties& GetProperties() const { return m_Properties; }
 
-        LogicalDevice* CreateLogicalDevice();
+        // features that aren't supported are left disabled
+        LogicalDevice* CreateLogicalDevice(const DeviceFeatures& requestedFeatures);
         SwapchainSupportDetails QuerySwapChainSupport();
-        uint32_t FindMemoryType(uint32_t memoryMask, VkMemoryPropertyFlags properties);
         
     private:
         PhysicalDevice(VkPhysicalDevice physicalDevice);
         static QueueFamilyIndices FindQueueFamilyIndices(VkPhysicalDevice physicalDevice);
-        static uint32_t RateDeviceSuitability(VkPhysicalDevice physicalDevice);
+        static DeviceRating RateDeviceSuitability(VkPhysicalDevice physicalDevice);
         static bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice);
+        static bool MatchesDeviceOverride(VkPhysicalDevice physicalDevice,
+                                          std::string_view deviceOverride);
+        void PrintQueueTopology() const;
 
     private:
         VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
         QueueFamilyIndices m_QueueFamilyIndices;
+        VkPhysicalDeviceProperties m_Properties;
+
+        static std::string m_DeviceOverride;
     };
 }
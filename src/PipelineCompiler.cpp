@@ -0,0 +1,84 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    PipelineCompiler::PipelineCompiler(uint32_t workerCount)
+    {
+        // leave most of the cores to the main and render threads
+        if (workerCount == 0)
+            workerCount = std::max(1u, std::thread::hardware_concurrency() / 4);
+
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            m_Workers.emplace_back([this](std::stop_token stopToken)
+            {
+                WorkerLoop(stopToken);
+            });
+        }
+    }
+
+    PipelineCompiler::~PipelineCompiler()
+    {
+        for (std::jthread& worker : m_Workers)
+            worker.request_stop();
+
+        m_Workers.clear();
+
+        // nobody is going to run these anymore, destroying the tasks makes
+        // their futures report a broken promise instead of blocking forever
+        m_Tasks.clear();
+    }
+
+    std::shared_future<PipelineCompileResult> PipelineCompiler::Submit(
+        CompileFunction&& compile)
+    {
+        std::packaged_task<PipelineCompileResult()> task(
+            [compile = std::move(compile)]()
+            {
+                auto start = std::chrono::steady_clock::now();
+
+                PipelineCompileResult result;
+                result.Pipeline = compile();
+                result.Milliseconds = 
+                    std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+                return result;
+            });
+
+        std::shared_future<PipelineCompileResult> future = 
+                                                task.get_future().share();
+        {
+            std::scoped_lock lock(m_Mutex);
+            m_Tasks.push_back(std::move(task));
+        }
+
+        m_Condition.notify_one();
+        return future;
+    }
+
+    void PipelineCompiler::WorkerLoop(std::stop_token stopToken)
+    {
+        OPTICK_THREAD("PipelineCompiler");
+
+        while (true)
+        {
+            std::packaged_task<PipelineCompileResult()> task;
+            {
+                std::unique_lock lock(m_Mutex);
+                if (!m_Condition.wait(lock, stopToken, 
+                                      [this] { return !m_Tasks.empty(); }))
+                    return;
+
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+}
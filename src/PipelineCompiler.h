@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LearningVulkan
+{
+    struct PipelineCompileResult
+    {
+        VkPipeline Pipeline = VK_NULL_HANDLE;
+        double Milliseconds = 0.0;
+    };
+
+    // Creates pipelines on worker threads so the frame loop never waits
+    // on the driver's shader compiler
+    class PipelineCompiler
+    {
+    public:
+        using CompileFunction = std::function<VkPipeline()>;
+
+        // 0 picks a worker count based on the hardware
+        PipelineCompiler(uint32_t workerCount = 0);
+        ~PipelineCompiler();
+
+        PipelineCompiler(const PipelineCompiler& other) = delete;
+        PipelineCompiler& operator=(const PipelineCompiler& other) = delete;
+
+        std::shared_future<PipelineCompileResult> Submit(
+            CompileFunction&& compile);
+
+    private:
+        void WorkerLoop(std::stop_token stopToken);
+
+    private:
+        std::mutex m_Mutex;
+        std::condition_variable_any m_Condition;
+        std::deque<std::packaged_task<PipelineCompileResult()>> m_Tasks;
+        std::vector<std::jthread> m_Workers;
+    };
+}
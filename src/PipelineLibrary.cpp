@@ -0,0 +1,158 @@
+#include "PipelineLibrary.h"
+
+#include "LogicalDevice.h"
+#include "RendererContext.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    PipelineLibrary::PipelineLibrary(const std::filesystem::path& cachePath)
+        : m_CachePath(cachePath)
+    {
+        LoadCache();
+    }
+
+    PipelineLibrary::~PipelineLibrary()
+    {
+        for (const auto& [name, pipeline] : m_Pipelines)
+            delete pipeline;
+        for (const auto& [name, pipeline] : m_ComputePipelines)
+            delete pipeline;
+
+        SaveCache();
+        RendererContext::GetDeviceDispatch().vkDestroyPipelineCache(
+            RendererContext::GetLogicalDevice()->GetVulkanDevice(),
+            m_PipelineCache, nullptr);
+    }
+
+    GraphicsPipeline* PipelineLibrary::Add(std::string_view name,
+        GraphicsPipelineCreateInfo createInfo)
+    {
+        assert(m_Pipelines.find(name) == m_Pipelines.end());
+
+        createInfo.Name = name;
+        createInfo.PipelineCache = m_PipelineCache;
+        createInfo.Compiler = &m_Compiler;
+        GraphicsPipeline* pipeline = new GraphicsPipeline(createInfo);
+        m_Pipelines.emplace(name, pipeline);
+        return pipeline;
+    }
+
+    GraphicsPipeline* PipelineLibrary::Get(std::string_view name) const
+    {
+        auto it = m_Pipelines.find(name);
+        return it != m_Pipelines.end() ? it->second : nullptr;
+    }
+
+    ComputePipeline* PipelineLibrary::AddCompute(std::string_view name,
+        ComputePipelineCreateInfo createInfo)
+    {
+        assert(m_ComputePipelines.find(name) == m_ComputePipelines.end());
+
+        // a single stage compiles fast enough to not need the compiler
+        createInfo.Name = name;
+        createInfo.PipelineCache = m_PipelineCache;
+        ComputePipeline* pipeline = new ComputePipeline(createInfo);
+        m_ComputePipelines.emplace(name, pipeline);
+        return pipeline;
+    }
+
+    ComputePipeline* PipelineLibrary::GetCompute(std::string_view name) const
+    {
+        auto it = m_ComputePipelines.find(name);
+        return it != m_ComputePipelines.end() ? it->second : nullptr;
+    }
+
+    void PipelineLibrary::Precompile(std::string_view name,
+        const std::vector<PipelineVariantKey>& variants)
+    {
+        OPTICK_EVENT();
+        GraphicsPipeline* pipeline = Get(name);
+        assert(pipeline != nullptr);
+
+        std::vector<std::shared_future<PipelineCompileResult>> futures;
+        for (PipelineVariantKey variant : variants)
+            futures.push_back(pipeline->RequestVariant(variant));
+
+        for (const auto& future : futures)
+            future.wait();
+
+        pipeline->Update();
+    }
+
+    void PipelineLibrary::Update()
+    {
+        for (const auto& [name, pipeline] : m_Pipelines)
+            pipeline->Update();
+    }
+
+    void PipelineLibrary::Rebuild(
+        const std::vector<std::filesystem::path>& shaderPaths)
+    {
+        auto rebuildAffected = [&shaderPaths](const auto& pipelines)
+        {
+            for (const auto& [name, pipeline] : pipelines)
+            {
+                bool affected = std::any_of(shaderPaths.begin(), 
+                                            shaderPaths.end(),
+                    [pipeline](const std::filesystem::path& shaderPath)
+                    {
+                        return pipeline->UsesShader(shaderPath);
+                    });
+
+                if (affected)
+                    pipeline->Rebuild();
+            }
+        };
+
+        rebuildAffected(m_Pipelines);
+        rebuildAffected(m_ComputePipelines);
+    }
+
+    void PipelineLibrary::LoadCache()
+    {
+        // the driver validates the header and ignores data from a 
+        // different device or driver version
+        std::vector<char> cacheData;
+        std::ifstream file(m_CachePath, std::ios::ate | std::ios::binary);
+        if (file.is_open())
+        {
+            cacheData.resize(file.tellg());
+            file.seekg(0);
+            file.read(cacheData.data(), cacheData.size());
+        }
+
+        VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+        pipelineCacheCreateInfo.sType = 
+                                VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+        pipelineCacheCreateInfo.pInitialData = cacheData.data();
+
+        assert(RendererContext::GetDeviceDispatch().vkCreatePipelineCache(
+            RendererContext::GetLogicalDevice()->GetVulkanDevice(),
+            &pipelineCacheCreateInfo, nullptr,
+            &m_PipelineCache) == VK_SUCCESS);
+    }
+
+    void PipelineLibrary::SaveCache() const
+    {
+        VkDevice device = RendererContext::GetLogicalDevice()->GetVulkanDevice();
+
+        size_t cacheSize = 0;
+        assert(RendererContext::GetDeviceDispatch().vkGetPipelineCacheData(device, m_PipelineCache, &cacheSize,
+                                      nullptr) == VK_SUCCESS);
+
+        std::vector<char> cacheData(cacheSize);
+        assert(RendererContext::GetDeviceDispatch().vkGetPipelineCacheData(device, m_PipelineCache, &cacheSize,
+                                      cacheData.data()) == VK_SUCCESS);
+
+        std::filesystem::create_directories(m_CachePath.parent_path());
+        std::ofstream file(m_CachePath, std::ios::binary);
+        file.write(cacheData.data(), cacheSize);
+    }
+}
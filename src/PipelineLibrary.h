@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ComputePipeline.h"
+#include "GraphicsPipeline.h"
+#include "PipelineCompiler.h"
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Owns the graphics and compute pipelines by name together with a
+    // pipeline cache that is shared by all of them and persisted between
+    // runs
+    class PipelineLibrary
+    {
+    public:
+        PipelineLibrary(const std::filesystem::path& cachePath);
+        ~PipelineLibrary();
+
+        PipelineLibrary(const PipelineLibrary& other) = delete;
+        PipelineLibrary& operator=(const PipelineLibrary& other) = delete;
+
+        GraphicsPipeline* Add(std::string_view name,
+                              GraphicsPipelineCreateInfo createInfo);
+        GraphicsPipeline* Get(std::string_view name) const;
+        ComputePipeline* AddCompute(std::string_view name,
+                                    ComputePipelineCreateInfo createInfo);
+        ComputePipeline* GetCompute(std::string_view name) const;
+
+        // compiles the variants in parallel and waits for them, meant for
+        // load time so that first use doesn't have to fall back
+        void Precompile(std::string_view name,
+                        const std::vector<PipelineVariantKey>& variants);
+
+        // puts finished background compiles into use, call once per frame
+        void Update();
+
+        // rebuilds every pipeline using one of the shaders
+        void Rebuild(const std::vector<std::filesystem::path>& shaderPaths);
+
+    private:
+        void LoadCache();
+        void SaveCache() const;
+
+    private:
+        std::filesystem::path m_CachePath;
+        VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+        // declared before the pipelines so it outlives their compiles
+        PipelineCompiler m_Compiler;
+        std::map<std::string, GraphicsPipeline*, std::less<>> m_Pipelines;
+        std::map<std::string, ComputePipeline*, std::less<>> 
+                                                        m_ComputePipelines;
+    };
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace LearningVulkan
+{
+    enum class QueueType
+    {
+        Graphics,
+        Transfer,
+        Compute,
+
+        Count,
+    };
+
+    // Exclusive resources belong to one queue family at a time and have to
+    // be released and acquired to move between families. Concurrent ones
+    // can be used by every family, but that can keep the driver from
+    // compressing them
+    enum class ResourceSharing
+    {
+        Exclusive,
+        Concurrent,
+    };
+
+    // how a queue uses a resource on one side of an ownership transfer
+    struct ResourceAccess
+    {
+        VkPipelineStageFlags Stages;
+        VkAccessFlags Access;
+    };
+
+    // a release that was recorded and still needs its acquire, the layouts
+    // are only used for images
+    struct PendingOwnershipTransfer
+    {
+        // VK_QUEUE_FAMILY_IGNORED when only the layout changes
+        uint32_t SrcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t DstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        VkImageLayout OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout NewLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+}
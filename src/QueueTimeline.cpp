@@ -0,0 +1,71 @@
+#include "QueueTimeline.h"
+
+#include <cassert>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    QueueTimeline::QueueTimeline(VkDevice device,
+                                 const DeviceDispatch& dispatch)
+        : m_Device(device), m_Dispatch(&dispatch)
+    {
+        // loaded under their KHR names on 1.1 devices
+        assert(m_Dispatch->vkWaitSemaphores && 
+               m_Dispatch->vkGetSemaphoreCounterValue);
+
+        VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+        semaphoreTypeCreateInfo.sType = 
+                                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        semaphoreTypeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+        assert(m_Dispatch->vkCreateSemaphore(m_Device, &semaphoreCreateInfo,
+                                             nullptr, &m_Semaphore) 
+               == VK_SUCCESS);
+    }
+
+    QueueTimeline::~QueueTimeline()
+    {
+        m_Dispatch->vkDestroySemaphore(m_Device, m_Semaphore, nullptr);
+    }
+
+    uint64_t QueueTimeline::GetCompleted() const
+    {
+        uint64_t value = 0;
+        VkResult result = m_Dispatch->vkGetSemaphoreCounterValue(
+                                            m_Device, m_Semaphore, &value);
+        assert(result == VK_SUCCESS);
+        return value;
+    }
+
+    bool QueueTimeline::IsComplete(uint64_t value) const
+    {
+        return GetCompleted() >= value;
+    }
+
+    bool QueueTimeline::Wait(uint64_t value, uint64_t timeout) const
+    {
+        // value 0 is the initial value, nothing to wait for
+        if (value == 0)
+            return true;
+
+        OPTICK_CATEGORY("WaitForTimeline", Optick::Category::Wait);
+        OPTICK_TAG("Value", value);
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_Semaphore;
+        waitInfo.pValues = &value;
+
+        VkResult result = m_Dispatch->vkWaitSemaphores(m_Device, &waitInfo,
+                                                       timeout);
+        assert(result == VK_SUCCESS || result == VK_TIMEOUT);
+        return result == VK_SUCCESS;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "VulkanFunctions.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace LearningVulkan
+{
+    // A timeline semaphore that every submit to a queue signals with the
+    // next value. Any point of the queue's work can be polled or waited on
+    // with the value returned for its submit, without fences
+    class QueueTimeline
+    {
+    public:
+        QueueTimeline(VkDevice device, const DeviceDispatch& dispatch);
+        ~QueueTimeline();
+
+        QueueTimeline(const QueueTimeline& other) = delete;
+        QueueTimeline& operator=(const QueueTimeline& other) = delete;
+
+        VkSemaphore GetSemaphore() const { return m_Semaphore; }
+
+        // reserves the value the next submit signals, the submits have to
+        // reach the queue in the order the values were reserved
+        uint64_t Advance() { return ++m_LastReserved; }
+        // the submit signaling this can still be sitting in a batch of the
+        // SubmitBatcher, the host can only wait on it once that was flushed
+        uint64_t GetLastReserved() const { return m_LastReserved; }
+
+        uint64_t GetCompleted() const;
+        bool IsComplete(uint64_t value) const;
+        // returns false if the timeout ran out first
+        bool Wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+    private:
+        VkDevice m_Device;
+        const DeviceDispatch* m_Dispatch;
+        VkSemaphore m_Semaphore;
+        uint64_t m_LastReserved = 0;
+    };
+}
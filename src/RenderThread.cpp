@@ -0,0 +1,141 @@
+#include "RenderThread.h"
+#include "RendererContext.h"
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    RenderThread::RenderThread(RendererContext* renderContext,
+                               VkExtent2D extent)
+        : m_RenderContext(renderContext), m_Extent(extent),
+        m_FramePacing(renderContext->GetFramePacing())
+    {
+        m_Thread = std::jthread([this](std::stop_token stopToken)
+        {
+            RenderLoop(stopToken);
+        });
+    }
+
+    RenderThread::~RenderThread()
+    {
+        // the packet that's being rendered is finished first,
+        // a pending one is dropped
+        m_Thread.request_stop();
+        m_Thread.join();
+    }
+
+    FramePacket& RenderThread::BeginPacket()
+    {
+        return m_Packets[m_WriteIndex];
+    }
+
+    void RenderThread::SubmitPacket()
+    {
+        OPTICK_EVENT();
+        std::unique_lock lock(m_Mutex);
+
+        // the render thread hasn't picked up the previous packet yet
+        m_Condition.wait(lock, [this]() { return !m_PacketReady; });
+
+        m_ReadIndex = m_WriteIndex;
+        m_PacketReady = true;
+        m_WriteIndex = (m_WriteIndex + 1) % m_Packets.size();
+        m_Condition.notify_all();
+
+        // the packet we're about to overwrite can still be in use
+        m_Condition.wait(lock, [this]()
+        {
+            return !m_Rendering || m_RenderingIndex != m_WriteIndex;
+        });
+    }
+
+    void RenderThread::PublishCamera(const CameraState& camera)
+    {
+        std::scoped_lock lock(m_CameraMutex);
+        m_LatestCamera = camera;
+    }
+
+    void RenderThread::SetFramePacing(FramePacingMode mode,
+                                      double targetFrameRate)
+    {
+        std::scoped_lock lock(m_PacingMutex);
+        m_PendingPacing = FramePacingRequest{ mode, targetFrameRate };
+        m_FramePacing = mode;
+    }
+
+    void RenderThread::WaitIdle()
+    {
+        std::unique_lock lock(m_Mutex);
+        m_Condition.wait(lock, [this]()
+        {
+            return !m_PacketReady && !m_Rendering;
+        });
+    }
+
+    void RenderThread::RenderLoop(std::stop_token stopToken)
+    {
+        OPTICK_THREAD("RenderThread");
+
+        while (true)
+        {
+            uint32_t packetIndex;
+
+            {
+                std::unique_lock lock(m_Mutex);
+                if (!m_Condition.wait(lock, stopToken,
+                                      [this]() { return m_PacketReady; }))
+                    return;
+
+                packetIndex = m_ReadIndex;
+                m_PacketReady = false;
+                m_RenderingIndex = packetIndex;
+                m_Rendering = true;
+            }
+            m_Condition.notify_all();
+
+            Render(m_Packets[packetIndex]);
+
+            {
+                std::scoped_lock lock(m_Mutex);
+                m_Rendering = false;
+            }
+            m_Condition.notify_all();
+        }
+    }
+
+    void RenderThread::Render(const FramePacket& packet)
+    {
+        OPTICK_EVENT();
+
+        // the pacer and swapchain are read all through the frame
+        std::optional<FramePacingRequest> pacing;
+        {
+            std::scoped_lock lock(m_PacingMutex);
+            pacing.swap(m_PendingPacing);
+        }
+        if (pacing)
+            m_RenderContext->SetFramePacing(pacing->Mode,
+                                            pacing->TargetFrameRate);
+
+        if (packet.Extent.width != m_Extent.width ||
+            packet.Extent.height != m_Extent.height)
+        {
+            m_Extent = packet.Extent;
+            m_RenderContext->Resize(m_Extent.width, m_Extent.height);
+        }
+
+        if (!m_RenderContext->BeginFrame(packet))
+            return;
+
+        // the main thread has kept polling while we recorded, so there can
+        // be a newer camera than the one the packet was built with
+        CameraState camera = packet.Camera;
+        if (m_LateInputLatching)
+        {
+            std::scoped_lock lock(m_CameraMutex);
+            camera = m_LatestCamera;
+        }
+
+        m_RenderContext->EndFrame(camera);
+    }
+}
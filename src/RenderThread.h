@@ -0,0 +1,90 @@
+#pragma once
+
+#include "FramePacket.h"
+#include "Camera.h"
+#include "FramePacer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace LearningVulkan
+{
+    class RendererContext;
+
+    // Records and submits frames on its own thread. The main thread fills
+    // one packet while the render thread consumes the other, they only
+    // meet in SubmitPacket so simulating frame N overlaps rendering N-1.
+    // NOTE: after construction the renderer may only be used from here
+    class RenderThread
+    {
+    public:
+        RenderThread(RendererContext* renderContext, VkExtent2D extent);
+        ~RenderThread();
+
+        RenderThread(const RenderThread& other) = delete;
+        RenderThread& operator=(const RenderThread& other) = delete;
+
+        // the packet the main thread is allowed to write to, it stays
+        // valid until the next SubmitPacket
+        FramePacket& BeginPacket();
+        // hands the packet over, blocks while the render thread is still 
+        // busy with the previous one
+        void SubmitPacket();
+
+        // the newest camera, picked up right before a frame is submitted
+        // when late input latching is enabled
+        void PublishCamera(const CameraState& camera);
+        void SetLateInputLatching(bool enabled) { m_LateInputLatching = enabled; }
+
+        // applied by the render thread before its next frame
+        void SetFramePacing(FramePacingMode mode, double targetFrameRate);
+        // the mode last requested, it might not be applied yet
+        FramePacingMode GetFramePacing() const { return m_FramePacing; }
+
+        // blocks until every submitted packet has been rendered
+        void WaitIdle();
+
+    private:
+        void RenderLoop(std::stop_token stopToken);
+        void Render(const FramePacket& packet);
+
+    private:
+        RendererContext* m_RenderContext;
+        // only touched by the render thread
+        VkExtent2D m_Extent;
+
+        std::array<FramePacket, 2> m_Packets;
+        // only touched by the main thread
+        uint32_t m_WriteIndex = 0;
+
+        std::mutex m_Mutex;
+        std::condition_variable_any m_Condition;
+        uint32_t m_ReadIndex = 0;
+        bool m_PacketReady = false;
+        uint32_t m_RenderingIndex = 0;
+        bool m_Rendering = false;
+
+        std::mutex m_CameraMutex;
+        CameraState m_LatestCamera;
+        std::atomic<bool> m_LateInputLatching = true;
+
+        struct FramePacingRequest
+        {
+            FramePacingMode Mode;
+            double TargetFrameRate;
+        };
+        std::mutex m_PacingMutex;
+        std::optional<FramePacingRequest> m_PendingPacing;
+        std::atomic<FramePacingMode> m_FramePacing;
+
+        // declared last so it's joined before the packets are destroyed
+        std::jthread m_Thread;
+    };
+}
@@ -24,6 +24,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/glm.hpp>
 #include <stb_image.h>
+#include <optick.h>
 
 #include "Vertex.h"
 
@@ -68,159 +69,127 @@ namespace LearningVulkan
                 | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
         }
 
-        VkResult CreateDebugUtilsMessanger(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* messangerCreateInfo,
-            const VkAllocationCallbacks* allocator, VkDebugUtilsMessengerEXT* debugMessanger)
-        {
-            PFN_vkCreateDebugUtilsMessengerEXT func = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT"));
-            assert(func);
+        constexpr const char* VertexShaderPath =
+                                            "assets/shaders/BasicVert.glsl";
+        constexpr const char* FragmentShaderPath =
+                                            "assets/shaders/BasicFrag.glsl";
 
-            return func(instance, messangerCreateInfo, allocator, debugMessanger);
-        }
+        constexpr const char* CubeIndicesShaderPath =
+                                    "assets/shaders/CubeIndicesComp.glsl";
 
-        void DestroyDebugUtilsMessanger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* allocator)
-        {
-            PFN_vkDestroyDebugUtilsMessengerEXT func = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
-                vkGetInstanceProcAddr(
-                    instance, "vkDestroyDebugUtilsMessengerEXT"));
-            assert(func);
+        constexpr uint32_t CubeIndexCount = 36;
+        constexpr uint32_t CubeFaceCount = 6;
+        // has to match local_size_x in CubeIndicesComp.glsl
+        constexpr uint32_t CubeIndicesGroupSize = 64;
 
-            func(instance, debugMessenger, allocator);
-        }
+        // whatever the device doesn't support ends up disabled in the
+        // logical device's capabilities
+        const DeviceFeatures RequestedFeatures = DeviceFeatures::All();
 
-        std::vector<char> ReadShaderFile(const std::filesystem::path& shaderPath)
-        {
-            std::ifstream file(shaderPath, std::ios::ate | std::ios::binary);
-
-            assert(file.is_open());
-
-            size_t fileSize = file.tellg();
-            std::vector<char> fileData(fileSize);
-            file.seekg(0);
-            file.read(fileData.data(), fileSize);
-
-            return fileData;
-        }
+        // the variants the application draws the cubes with
+        const std::vector<PipelineVariantKey> CubeVariants = {
+            PipelineVariantKey::All(),
+            PipelineVariantKey::All().Disable(ShaderFeature::Texturing),
+        };
     }
 
     VkInstance RendererContext::m_Instance;
+    InstanceDispatch RendererContext::m_InstanceDispatch;
+    uint32_t RendererContext::m_InstanceVersion;
     VkSurfaceKHR RendererContext::m_Surface;
     LogicalDevice* RendererContext::m_LogicalDevice;
-    VkCommandPool RendererContext::m_TransientTransferCommandPool;
-    VkCommandPool RendererContext::m_TransientGraphicsCommandPool;
-
-    static float fov = 45.0f;
-
-    static void MouseScrollCallback(GLFWwindow* window, double x, double y)
+    DeletionQueue* RendererContext::m_DeletionQueue;
+    ShaderCompiler* RendererContext::m_ShaderCompiler;
+    MemoryTracker* RendererContext::m_MemoryTracker;
+    LayoutCache* RendererContext::m_LayoutCache;
+    CommandBufferAllocator* RendererContext::m_CommandBufferAllocator;
+
+    RendererContext::RendererContext(std::string_view applicationName,
+                                     uint32_t framesInFlight)
+        : m_FramesInFlight(framesInFlight)
     {
-        fov -= y;
-    }
+        OPTICK_EVENT();
+        assert(m_FramesInFlight > 0);
 
-    RendererContext::RendererContext(std::string_view applicationName)
-    {
         CreateVulkanInstance(applicationName);
         SetupDebugMessenger();
         CreateSurface();
 
         m_PhysicalDevice = PhysicalDevice::GetSuitablePhysicalDevice();
         assert(m_PhysicalDevice != nullptr);
-        m_LogicalDevice = m_PhysicalDevice->CreateLogicalDevice();
+        m_LogicalDevice = m_PhysicalDevice->CreateLogicalDevice(
+                                                        RequestedFeatures);
+        InitGpuProfiling();
+        m_MemoryTracker = new MemoryTracker(
+                                    m_PhysicalDevice->GetPhysicalDevice(),
+                                    m_LogicalDevice->IsMemoryBudgetEnabled());
+        m_MemoryTracker->PrintMemoryStrategies();
+        m_DeletionQueue = new DeletionQueue(
+                                        m_LogicalDevice->GetVulkanDevice(),
+                                        m_LogicalDevice->GetDispatch());
+        m_CommandBufferAllocator = new CommandBufferAllocator(
+                                        m_LogicalDevice, m_FramesInFlight);
+        m_ShaderCompiler = new ShaderCompiler("assets/shaders/cache");
+        m_LayoutCache = new LayoutCache(m_LogicalDevice->GetVulkanDevice());
+        m_ShaderWatcher = new ShaderWatcher(m_ShaderCompiler);
 
         const Window* window = Application::Get()->GetWindow();
-
-        glfwSetScrollCallback(window->GetNativeWindow(), MouseScrollCallback);
+        m_PendingExtent = { window->GetWidth(), window->GetHeight() };
 
         m_Swapchain = new Swapchain(
             m_LogicalDevice,
             window->GetWidth(),
             window->GetHeight(),
-            PresentMode::Mailbox);
+            m_FramePacer.GetPreferredPresentMode());
 
 
         CreateRenderPass();
+        CreatePerImageObjects();
 
-        m_Framebuffers.reserve(m_Swapchain->GetImageViews().size());
-        for (size_t i = 0; i < m_Swapchain->GetImageViews().size(); i++)
-        {
-            const VkExtent2D& extent = m_Swapchain->GetExtent();
-
-            std::vector attachments
-            {
-                m_Swapchain->GetImageViews().at(i),
-                m_Swapchain->GetDepthImage()->GetVulkanImageView(),
-            };
-
-            Framebuffer* framebuffer = new Framebuffer(
-                m_RenderPass, attachments,
-                extent.width, extent.height);
-            m_Framebuffers.push_back(framebuffer);
-        }
-
-        m_PerFrameData.resize(m_Swapchain->GetImageViews().size());
-        for (size_t i = 0; i < m_Swapchain->GetImageViews().size(); ++i)
+        m_PerFrameData.resize(m_FramesInFlight);
+        for (uint32_t i = 0; i < m_FramesInFlight; ++i)
             CreatePerFrameObjects(i);
 
-        const QueueFamilyIndices& queueFamilyIndices =
-            m_PhysicalDevice->GetQueueFamilyIndices();
-        m_TransientTransferCommandPool = CreateCommandPool(
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
-            queueFamilyIndices.TransferFamily.value());
-        m_TransientGraphicsCommandPool = CreateCommandPool(
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
-            queueFamilyIndices.GraphicsFamily.value());
-
         CreateTexture();
-        CreateCameraDescriptorSetLayout();
+        // the descriptor set layouts come from the pipeline's shaders
+        CreateGraphicsPipeline();
+        CreateComputePipeline();
         CreateDescriptorPool();
         CreateDescriptorSets();
 
-        CreateGraphicsPipeline();
         AddCube();
         AddCube(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
 
         CreateVertexBuffer();
         CreateIndexBuffer();
+        // the static resources can't be used before this
+        FlushUploads();
 
     }
 
     RendererContext::~RendererContext()
     {
-        vkDestroyCommandPool(m_LogicalDevice->GetVulkanDevice(),
-                             m_TransientTransferCommandPool, nullptr);
-        vkDestroyCommandPool(m_LogicalDevice->GetVulkanDevice(),
-                             m_TransientGraphicsCommandPool, nullptr);
+        // stop watching before anything it could recompile for is gone
+        delete m_ShaderWatcher;
 
         for (const PerFrameData& data : m_PerFrameData)
         {
-            vkDestroySemaphore(m_LogicalDevice->GetVulkanDevice(),
+            GetDeviceDispatch().vkDestroySemaphore(m_LogicalDevice->GetVulkanDevice(),
                                data.SwapchainImageAcquireSemaphore, nullptr);
-            vkDestroySemaphore(m_LogicalDevice->GetVulkanDevice(),
-                               data.QueueReadySemaphore, nullptr);
-            vkDestroyFence(m_LogicalDevice->GetVulkanDevice(),
-                            data.PresentFence, nullptr);
-            delete data.CommandBuffer;
-            vkDestroyCommandPool(m_LogicalDevice->GetVulkanDevice(),
-                            data.CommandPool, nullptr);
-
             delete data.CameraUniformBuffer;
         }
 
         m_PerFrameData.clear();
 
-        vkDestroyPipeline(m_LogicalDevice->GetVulkanDevice(),
-                          m_Pipeline, nullptr);
-        vkDestroyPipelineLayout(m_LogicalDevice->GetVulkanDevice(),
-                            m_PipelineLayout, nullptr);
+        delete m_PipelineLibrary;
         
-        for (const auto& framebuffer : m_Framebuffers)
-            delete framebuffer;
+        DestroyPerImageObjects();
 
-        vkDestroyRenderPass(m_LogicalDevice->GetVulkanDevice(),
+        GetDeviceDispatch().vkDestroyRenderPass(m_LogicalDevice->GetVulkanDevice(),
                             m_RenderPass, nullptr);
 
-        vkDestroyDescriptorPool(m_LogicalDevice->GetVulkanDevice(),
+        GetDeviceDispatch().vkDestroyDescriptorPool(m_LogicalDevice->GetVulkanDevice(),
                                 m_DescriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(m_LogicalDevice->GetVulkanDevice(),
-                                     m_CameraDescriptorSetLayout, nullptr);
 
         delete m_Swapchain;
 
@@ -230,30 +199,48 @@ namespace LearningVulkan
 
         delete m_TestImageSampler;
         delete m_TestImage;
+
+        // the device is idle at this point so everything that was released
+        // can be destroyed
+        m_DeletionQueue->FlushAll();
+        delete m_DeletionQueue;
+        delete m_CommandBufferAllocator;
+        delete m_MemoryTracker;
+        delete m_LayoutCache;
+        delete m_ShaderCompiler;
+
+        // the gpu profiler owns query pools and command buffers on our
+        // device, so it has to go before it
+        OPTICK_SHUTDOWN();
         delete m_LogicalDevice;
 
-        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        m_InstanceDispatch.vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
 
         delete m_PhysicalDevice;
 
-        DestroyDebugUtilsMessanger(m_Instance, m_DebugMessenger, nullptr);
-        vkDestroyInstance(m_Instance, nullptr);
+        m_InstanceDispatch.vkDestroyDebugUtilsMessengerEXT(m_Instance,
+                                                m_DebugMessenger, nullptr);
+        m_InstanceDispatch.vkDestroyInstance(m_Instance, nullptr);
     }
 
     VkInstance RendererContext::GetVulkanInstance()
     { return m_Instance; }
 
+    const InstanceDispatch& RendererContext::GetInstanceDispatch()
+    { return m_InstanceDispatch; }
+
+    const DeviceDispatch& RendererContext::GetDeviceDispatch()
+    { return m_LogicalDevice->GetDispatch(); }
+
+    uint32_t RendererContext::GetInstanceVersion()
+    { return m_InstanceVersion; }
+
     VkSurfaceKHR RendererContext::GetVulkanSurface()
     { return m_Surface; }
 
-    VkCommandPool RendererContext::GetTransientTransferCommandPool()
-    {
-        return m_TransientTransferCommandPool;
-    }
-
-    VkCommandPool RendererContext::GetTransientGraphicsCommandPool()
+    CommandBufferAllocator* RendererContext::GetCommandBufferAllocator()
     {
-        return m_TransientGraphicsCommandPool;
+        return m_CommandBufferAllocator;
     }
 
     const PhysicalDevice* RendererContext::GetPhysicalDevice() const
@@ -266,6 +253,26 @@ namespace LearningVulkan
         return m_LogicalDevice;
     }
 
+    DeletionQueue* RendererContext::GetDeletionQueue()
+    {
+        return m_DeletionQueue;
+    }
+
+    MemoryTracker* RendererContext::GetMemoryTracker()
+    {
+        return m_MemoryTracker;
+    }
+
+    ShaderCompiler* RendererContext::GetShaderCompiler()
+    {
+        return m_ShaderCompiler;
+    }
+
+    LayoutCache* RendererContext::GetLayoutCache()
+    {
+        return m_LayoutCache;
+    }
+
     Swapchain* RendererContext::GetSwapchain() const
     {
         return m_Swapchain;
@@ -291,27 +298,86 @@ namespace LearningVulkan
         return m_PerFrameData.size();
     }
 
-    const VkPipeline& RendererContext::GetGraphicsPipeline() const
+    uint32_t RendererContext::GetFramesInFlight() const
+    {
+        return m_FramesInFlight;
+    }
+
+    GraphicsPipeline* RendererContext::GetGraphicsPipeline() const
+    {
+        return m_GraphicsPipeline;
+    }
+
+    uint32_t RendererContext::GetCubeCount() const
+    {
+        return m_CubeCount;
+    }
+
+    const std::vector<PipelineVariantKey>& RendererContext::GetCubeVariants()
+    {
+        return CubeVariants;
+    }
+
+    void RendererContext::SetFramePacing(FramePacingMode mode,
+                                         double targetFrameRate)
     {
-        return m_Pipeline;
+        m_FramePacer.SetMode(mode);
+        m_FramePacer.SetTargetFrameRate(targetFrameRate);
+
+        // the present mode can only be changed by recreating the swapchain
+        m_Swapchain->SetPresentMode(m_FramePacer.GetPreferredPresentMode());
+        m_SwapchainOutOfDate = true;
+    }
+
+    FramePacingMode RendererContext::GetFramePacing() const
+    {
+        return m_FramePacer.GetMode();
     }
 
     void RendererContext::Resize(uint32_t width, uint32_t height)
     {
-        m_LogicalDevice->WaitIdle();
+        // the swapchain gets recreated at the start of the next frame
+        m_PendingExtent = { width, height };
+        m_SwapchainOutOfDate = true;
+    }
 
-        m_Swapchain->Resize(width, height);
-        
-        uint32_t index = 0;
-        for (const auto& framebuffer : m_Framebuffers)
-        {
-            std::vector attachments
-            {
-                m_Swapchain->GetImageViews().at(index++),
-                m_Swapchain->GetDepthImage()->GetVulkanImageView(),
-            };
-            framebuffer->Resize(attachments, width, height);
-        }
+    void RendererContext::RecreateSwapchain()
+    {
+        OPTICK_EVENT();
+
+        // the old swapchain is passed as oldSwapchain and, together with
+        // everything that references its images, released through the
+        // deletion queue so there's no need to wait for the device
+        m_Swapchain->Resize(m_PendingExtent.width, m_PendingExtent.height);
+
+        // the image count can change with the new swapchain
+        DestroyPerImageObjects();
+        CreatePerImageObjects();
+
+        // present ids only have to increase per swapchain
+        m_PresentId = 0;
+        m_SwapchainOutOfDate = false;
+    }
+
+    void RendererContext::WaitForPresentation()
+    {
+        if (m_FramePacer.GetMode() != FramePacingMode::VSync ||
+            !m_LogicalDevice->IsPresentWaitEnabled() || m_PresentId < 2)
+            return;
+
+        OPTICK_CATEGORY("WaitForPresentation", Optick::Category::Wait);
+
+        // start the frame once the one before the previous is on screen,
+        // this keeps a single frame queued for the display instead of
+        // letting the cpu run ahead until the swapchain blocks.
+        // the timeout guards against windows that never get presented
+        // (e.g. hidden ones)
+        constexpr uint64_t PresentWaitTimeout = 100'000'000;
+        VkResult result = m_Swapchain->WaitForPresent(m_PresentId - 1,
+                                                      PresentWaitTimeout);
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            m_SwapchainOutOfDate = true;
     }
 
     void RendererContext::CreateVulkanInstance(
@@ -321,7 +387,15 @@ namespace LearningVulkan
         applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
         applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         applicationInfo.pApplicationName = applicationName.data();
-        applicationInfo.apiVersion = VK_API_VERSION_1_0;
+
+        // the newest version we know how to use, devices can still be on
+        // an older one so features are negotiated per device
+        uint32_t instanceVersion = VK_API_VERSION_1_0;
+        assert(vkEnumerateInstanceVersion(&instanceVersion) == VK_SUCCESS);
+        // 1.1 for vkGetPhysicalDeviceFeatures2
+        assert(instanceVersion >= VK_API_VERSION_1_1);
+        m_InstanceVersion = std::min(instanceVersion, VK_API_VERSION_1_3);
+        applicationInfo.apiVersion = m_InstanceVersion;
 
         VkInstanceCreateInfo instanceCreateInfo{};
         instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -351,6 +425,9 @@ namespace LearningVulkan
         instanceCreateInfo.pNext = &debugMessengerCreateInfo;
 
         vkCreateInstance(&instanceCreateInfo, nullptr, &m_Instance);
+
+        // everything past creating the instance goes through the tables
+        m_InstanceDispatch.Load(m_Instance);
     }
 
     bool RendererContext::CheckLayersAvailability()
@@ -373,7 +450,7 @@ namespace LearningVulkan
     {
         VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo{};
         SetupDebugUtilsMessengerCreateInfo(debugMessengerCreateInfo);
-        assert(CreateDebugUtilsMessanger(m_Instance,
+        assert(m_InstanceDispatch.vkCreateDebugUtilsMessengerEXT(m_Instance,
                                  &debugMessengerCreateInfo,
                                  nullptr, &m_DebugMessenger) == VK_SUCCESS);
     }
@@ -385,8 +462,49 @@ namespace LearningVulkan
                                        nullptr, &m_Surface) == VK_SUCCESS);
     }
 
+    void RendererContext::InitGpuProfiling()
+    {
+#if OPTICK_ENABLE_GPU_VULKAN
+        // optick records into our command buffers, so it gets the same
+        // entry points the renderer uses
+        const DeviceDispatch& dispatch = m_LogicalDevice->GetDispatch();
+        Optick::VulkanFunctions functions{};
+        functions.vkGetPhysicalDeviceProperties = 
+                            m_InstanceDispatch.vkGetPhysicalDeviceProperties;
+        functions.vkCreateQueryPool = dispatch.vkCreateQueryPool;
+        functions.vkCreateCommandPool = dispatch.vkCreateCommandPool;
+        functions.vkAllocateCommandBuffers = dispatch.vkAllocateCommandBuffers;
+        functions.vkCreateFence = dispatch.vkCreateFence;
+        functions.vkCmdResetQueryPool = dispatch.vkCmdResetQueryPool;
+        functions.vkQueueSubmit = dispatch.vkQueueSubmit;
+        functions.vkWaitForFences = dispatch.vkWaitForFences;
+        functions.vkResetCommandBuffer = dispatch.vkResetCommandBuffer;
+        functions.vkCmdWriteTimestamp = dispatch.vkCmdWriteTimestamp;
+        functions.vkGetQueryPoolResults = dispatch.vkGetQueryPoolResults;
+        functions.vkBeginCommandBuffer = dispatch.vkBeginCommandBuffer;
+        functions.vkEndCommandBuffer = dispatch.vkEndCommandBuffer;
+        functions.vkResetFences = dispatch.vkResetFences;
+        functions.vkDestroyCommandPool = dispatch.vkDestroyCommandPool;
+        functions.vkDestroyQueryPool = dispatch.vkDestroyQueryPool;
+        functions.vkDestroyFence = dispatch.vkDestroyFence;
+        functions.vkFreeCommandBuffers = dispatch.vkFreeCommandBuffers;
+
+        // optick only resolves the timestamps of its first node when
+        // flipping, so only the graphics queue gets gpu zones
+        VkDevice device = m_LogicalDevice->GetVulkanDevice();
+        VkPhysicalDevice physicalDevice = m_PhysicalDevice->GetPhysicalDevice();
+        VkQueue queue = m_LogicalDevice->GetGraphicsQueue();
+        uint32_t queueFamily = 
+            m_PhysicalDevice->GetQueueFamilyIndices().GraphicsFamily.value();
+
+        OPTICK_GPU_INIT_VULKAN(&device, &physicalDevice, &queue, &queueFamily,
+                               1, &functions);
+#endif
+    }
+
     void RendererContext::CreateRenderPass()
     {
+        OPTICK_EVENT();
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = m_Swapchain->GetSurfaceFormat().format;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -451,672 +569,634 @@ namespace LearningVulkan
         renderPassCreateInfo.dependencyCount = 1;
         renderPassCreateInfo.pDependencies = &subpassDependency;
 
-        assert(vkCreateRenderPass(m_LogicalDevice->GetVulkanDevice(),
+        assert(GetDeviceDispatch().vkCreateRenderPass(m_LogicalDevice->GetVulkanDevice(),
                                 &renderPassCreateInfo, nullptr,
                                 &m_RenderPass) == VK_SUCCESS);
     }
 
-    VkCommandPool RendererContext::CreateCommandPool(
-        VkCommandPoolCreateFlags commandPoolFlags,
-        uint32_t queueFamilyIndex) const
-    {
-        VkCommandPoolCreateInfo commandPoolCreateInfo{};
-        commandPoolCreateInfo.sType =
-            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        commandPoolCreateInfo.flags = commandPoolFlags;
-        commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
-
-        VkCommandPool commandPool;
-        assert(vkCreateCommandPool(m_LogicalDevice->GetVulkanDevice(),
-                                   &commandPoolCreateInfo, nullptr,
-                                   &commandPool) == VK_SUCCESS);
-        return commandPool;
-    }
-
-    CommandBuffer RendererContext::CreateStackCommandBuffer(
-        VkCommandPool commandPool)
+    void RendererContext::RecordCommandBuffer(
+        uint32_t imageIndex, const PerFrameData& frameData,
+        const std::vector<DrawItem>& draws)
     {
-        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-        commandBufferAllocateInfo.sType =
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.commandBufferCount = 1;
-        commandBufferAllocateInfo.commandPool = commandPool;
-        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        
-        VkCommandBuffer vulkanCommandBuffer;
-        assert(vkAllocateCommandBuffers(m_LogicalDevice->GetVulkanDevice(),
-                                        &commandBufferAllocateInfo,
-                                        &vulkanCommandBuffer) == VK_SUCCESS);
-        CommandBuffer commandBuffer(commandPool, std::move(vulkanCommandBuffer));
+        OPTICK_EVENT();
+        CommandBuffer& commandBuffer = *frameData.CommandBuffer;
+        commandBuffer.Begin();
 
-        return commandBuffer;
-    }
+        {
+            // gpu zones are timestamps written into this command buffer, so
+            // they have to close before it ends
+            OPTICK_GPU_CONTEXT(commandBuffer.GetVulkanCommandBuffer());
+            OPTICK_GPU_EVENT("Frame");
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.framebuffer = m_Framebuffers.at(imageIndex)
+                                            ->GetVulkanFramebuffer();
+            renderPassInfo.renderPass = m_RenderPass;
+            renderPassInfo.renderArea.extent = m_Swapchain->GetExtent();
+            renderPassInfo.renderArea.offset = { 0, 0 };
+
+            std::array<VkClearValue, 2> clearColor{};
+            clearColor[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
+            clearColor[1].depthStencil= { 1.0f, 0, };
+            renderPassInfo.clearValueCount = clearColor.size();
+            renderPassInfo.pClearValues = clearColor.data();
 
-    CommandBuffer* RendererContext::CreateCommandBuffer(VkCommandPool commandPool)
-    {
-        VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-        commandBufferAllocateInfo.sType =
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.commandBufferCount = 1;
-        commandBufferAllocateInfo.commandPool = commandPool;
-        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-        VkCommandBuffer vulkanCommandBuffer;
-        assert(vkAllocateCommandBuffers(m_LogicalDevice->GetVulkanDevice(),
-            &commandBufferAllocateInfo,
-            &vulkanCommandBuffer) == VK_SUCCESS);
-        CommandBuffer* commandBuffer = new CommandBuffer(commandPool, std::move(vulkanCommandBuffer));
-        return commandBuffer;
-    }
+            {
+                OPTICK_GPU_EVENT("MainPass");
+                commandBuffer.BeginRenderPass(renderPassInfo);
 
+                commandBuffer.BindVertexBuffer(m_VertexBuffer);
 
-    void RendererContext::RecordCommandBuffer(
-        uint32_t imageIndex, CommandBuffer& commandBuffer)
-    {
-        commandBuffer.Begin();
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.framebuffer = m_Framebuffers.at(imageIndex)
-                                        ->GetVulkanFramebuffer();
-        renderPassInfo.renderPass = m_RenderPass;
-        renderPassInfo.renderArea.extent = m_Swapchain->GetExtent();
-        renderPassInfo.renderArea.offset = { 0, 0 };
-
-        std::array<VkClearValue, 2> clearColor{};
-        clearColor[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
-        clearColor[1].depthStencil= { 1.0f, 0, };
-        renderPassInfo.clearValueCount = clearColor.size();
-        renderPassInfo.pClearValues = clearColor.data();
-
-        commandBuffer.BeginRenderPass(renderPassInfo);
-        commandBuffer.BindPipeline(m_Pipeline);
-
-        commandBuffer.BindVertexBuffer(m_VertexBuffer);
-
-        commandBuffer.BindIndexBuffer(m_IndexBuffer);
+                commandBuffer.BindIndexBuffer(m_IndexBuffer);
         
-        VkViewport viewport;
-        viewport.x = 0;
-        viewport.y = 0;
-        viewport.width = m_Swapchain->GetExtent().width;
-        viewport.height = m_Swapchain->GetExtent().height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        commandBuffer.SetViewport(viewport);
-
-        VkRect2D scissor;
-        scissor.offset = { 0, 0 };
-        scissor.extent = m_Swapchain->GetExtent();
-        commandBuffer.SetScissor(scissor);
+                VkViewport viewport;
+                viewport.x = 0;
+                viewport.y = 0;
+                viewport.width = m_Swapchain->GetExtent().width;
+                viewport.height = m_Swapchain->GetExtent().height;
+                viewport.minDepth = 0.0f;
+                viewport.maxDepth = 1.0f;
+                commandBuffer.SetViewport(viewport);
+
+                VkRect2D scissor;
+                scissor.offset = { 0, 0 };
+                scissor.extent = m_Swapchain->GetExtent();
+                commandBuffer.SetScissor(scissor);
         
-        //vkCmdDraw(commandBuffer, m_Vertices.size(), 1, 0, 0);
-        commandBuffer.BindDescriptorSets(m_PipelineLayout, m_DescriptorSets.at(imageIndex));
-
-        commandBuffer.DrawIndexed(m_Indices.size(), 1, 0, 0, 0);
+                //vkCmdDraw(commandBuffer, m_Vertices.size(), 1, 0, 0);
+                commandBuffer.BindDescriptorSets(
+                    m_GraphicsPipeline->GetLayout(),
+                    frameData.CameraDescriptorSet);
+
+                // one draw per cube so each one can get its own tint
+                // without touching a buffer or descriptor set, all variants
+                // share a layout so the descriptor set stays bound across
+                // pipeline switches
+                for (const DrawItem& draw : draws)
+                {
+                    assert(draw.Mesh < m_CubeCount);
+
+                    // falls back to another variant while this one is
+                    // compiling
+                    VkPipeline pipeline = 
+                        m_GraphicsPipeline->GetVariant(draw.Variant);
+                    if (pipeline == VK_NULL_HANDLE)
+                        continue;
+
+                    commandBuffer.BindPipeline(pipeline);
+
+                    DrawData drawData{};
+                    drawData.Tint = draw.Tint;
+                    commandBuffer.PushConstants(
+                        m_GraphicsPipeline->GetLayout(),
+                        m_GraphicsPipeline->GetReflection(), drawData);
+
+                    commandBuffer.DrawIndexed(CubeIndexCount, 1,
+                        draw.Mesh * CubeIndexCount, 0, 0);
+                }
+
+                commandBuffer.EndRenderPass();
+            }
+        }
 
-        commandBuffer.EndRenderPass();
         commandBuffer.End();
     }
 
     void RendererContext::CreateSyncObjects(
-        VkSemaphore& swapchainImageAcquireSemaphore,
-        VkSemaphore& queueReadySemaphore, VkFence& presentFence)
+        VkSemaphore& swapchainImageAcquireSemaphore)
     {
         VkSemaphoreCreateInfo semaphoreCreateInfo{};
         semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        assert(vkCreateSemaphore(m_LogicalDevice->GetVulkanDevice(),
+        assert(GetDeviceDispatch().vkCreateSemaphore(m_LogicalDevice->GetVulkanDevice(),
                                  &semaphoreCreateInfo, nullptr,
                                  &swapchainImageAcquireSemaphore) == VK_SUCCESS);
-
-        assert(vkCreateSemaphore(m_LogicalDevice->GetVulkanDevice(),
-                                 &semaphoreCreateInfo, nullptr,
-                                 &queueReadySemaphore) == VK_SUCCESS);
-
-        VkFenceCreateInfo fenceCreateInfo{};
-        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        assert(vkCreateFence(m_LogicalDevice->GetVulkanDevice(),
-                             &fenceCreateInfo, nullptr,
-                             &presentFence) == VK_SUCCESS);
     }
 
     void RendererContext::CreatePerFrameObjects(uint32_t frameIndex)
     {
+        OPTICK_EVENT();
         PerFrameData& data = m_PerFrameData.at(frameIndex);
-        const QueueFamilyIndices& queueFamilyIndices =
-                                    m_PhysicalDevice->GetQueueFamilyIndices();
-        data.CommandPool = CreateCommandPool(
-            VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            queueFamilyIndices.GraphicsFamily.value());
-        data.CommandBuffer = CreateCommandBuffer(data.CommandPool);
-        CreateSyncObjects(
-            data.SwapchainImageAcquireSemaphore,
-            data.QueueReadySemaphore,
-            data.PresentFence);
-
+        CreateSyncObjects(data.SwapchainImageAcquireSemaphore);
+
+        // written every frame, so the gpu reads it from vram when the cpu
+        // can write there
+        MemoryStrategy uniformStrategy = m_MemoryTracker->CanUse(
+            MemoryStrategy::DeviceLocalMappable, sizeof(CameraData),
+            GPUBuffer::GetMemoryTypeBits(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)) 
+            ? MemoryStrategy::DeviceLocalMappable : MemoryStrategy::Upload;
         data.CameraUniformBuffer = new GPUBuffer(
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             sizeof(CameraData), 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            m_MemoryTracker->GetMemoryProperties(uniformStrategy),
+            MemoryCategory::Uniform);
 
         data.CameraUniformBufferMemory = data.CameraUniformBuffer->MapMemory();
     }
 
-    void RendererContext::DrawFrame()
+    void RendererContext::CreatePerImageObjects()
     {
-        PerFrameData& currentFrameData = m_PerFrameData.at(m_FrameIndex);
-        assert(vkWaitForFences(m_LogicalDevice->GetVulkanDevice(), 1,
-                               &currentFrameData.PresentFence,
-                               VK_TRUE, UINT64_MAX) == VK_SUCCESS);
-        vkResetFences(m_LogicalDevice->GetVulkanDevice(), 1,
-                      &currentFrameData.PresentFence);
-
-        uint32_t imageIndex;
-        m_Swapchain->AcquireNextImage(
-                    currentFrameData.SwapchainImageAcquireSemaphore,
-                    imageIndex);
-
-        vkResetCommandBuffer(currentFrameData.CommandBuffer->GetVulkanCommandBuffer(), 0);
-
-        UpdateUniformBuffer(m_FrameIndex);
-
-        RecordCommandBuffer(imageIndex, *currentFrameData.CommandBuffer);
+        OPTICK_EVENT();
+        const std::vector<VkImageView>& imageViews =
+                                                m_Swapchain->GetImageViews();
+        const VkExtent2D& extent = m_Swapchain->GetExtent();
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &currentFrameData.CommandBuffer->GetVulkanCommandBuffer();
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &currentFrameData.QueueReadySemaphore;
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = 
-                            &currentFrameData.SwapchainImageAcquireSemaphore;
+        m_Framebuffers.reserve(imageViews.size());
+        for (size_t i = 0; i < imageViews.size(); i++)
+        {
+            std::vector attachments
+            {
+                imageViews.at(i),
+                m_Swapchain->GetDepthImage()->GetVulkanImageView(),
+            };
 
-        VkPipelineStageFlags waitStages = 
-                            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.pWaitDstStageMask = &waitStages;
+            Framebuffer* framebuffer = new Framebuffer(
+                m_RenderPass, attachments,
+                extent.width, extent.height);
+            m_Framebuffers.push_back(framebuffer);
+        }
 
-        assert(vkQueueSubmit(m_LogicalDevice->GetGraphicsQueue(), 1,
-                             &submitInfo,
-                             currentFrameData.PresentFence) == VK_SUCCESS);
-        m_Swapchain->Present(currentFrameData.QueueReadySemaphore, imageIndex);
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        m_FrameIndex = (m_FrameIndex + 1) % m_PerFrameData.size();
+        m_PerImageData.resize(imageViews.size());
+        for (PerImageData& data : m_PerImageData)
+        {
+            data.TimelineValue = 0;
+            assert(GetDeviceDispatch().vkCreateSemaphore(m_LogicalDevice->GetVulkanDevice(),
+                                     &semaphoreCreateInfo, nullptr,
+                                     &data.QueueReadySemaphore) == VK_SUCCESS);
+        }
     }
 
-    void RendererContext::CreateGraphicsPipeline()
+    void RendererContext::DestroyPerImageObjects()
     {
-        VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
-        graphicsPipelineCreateInfo.sType =
-                            VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        
-        std::vector<char> vertexShaderData = ReadShaderFile(
-                                        "assets/shaders/bin/BasicVert.spv");
-        std::vector<char> fragmentShaderData = ReadShaderFile(
-                                        "assets/shaders/bin/BasicFrag.spv");
-
-        VkShaderModule vertexShaderModule = CreateShader(vertexShaderData);
-        VkShaderModule fragmentShaderModule = CreateShader(fragmentShaderData);
-
-#pragma region Shader Stages
-            VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo{};
-            vertexShaderStageCreateInfo.sType = 
-                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            vertexShaderStageCreateInfo.module = vertexShaderModule;
-            vertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-            vertexShaderStageCreateInfo.pName = "main";
-
-            VkPipelineShaderStageCreateInfo fragmentShaderStageCreateInfo{};
-            fragmentShaderStageCreateInfo.sType =
-                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            fragmentShaderStageCreateInfo.module = fragmentShaderModule;
-            fragmentShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-            fragmentShaderStageCreateInfo.pName = "main";
-
-            std::array shaderStages =
-            {
-                vertexShaderStageCreateInfo,
-                fragmentShaderStageCreateInfo
-            };
+        for (const auto& framebuffer : m_Framebuffers)
+            delete framebuffer;
 
-            graphicsPipelineCreateInfo.pStages = shaderStages.data();
-            graphicsPipelineCreateInfo.stageCount = shaderStages.size();
-#pragma endregion
-
-
-#pragma region Vertex Input State
-            VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
-            vertexInputCreateInfo.sType =
-                    VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-            vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-            VkVertexInputBindingDescription vertexBindingDescription =
-                                            Vertex::GetBindingDescription();
-            vertexInputCreateInfo.pVertexBindingDescriptions = 
-                                                    &vertexBindingDescription;
-
-            std::array vertexAttributeDescription = 
-                                            Vertex::GetAttributeDescriptions();
-            vertexInputCreateInfo.vertexAttributeDescriptionCount =
-                                            vertexAttributeDescription.size();
-            vertexInputCreateInfo.pVertexAttributeDescriptions =
-                                            vertexAttributeDescription.data();
-
-            graphicsPipelineCreateInfo.pVertexInputState =
-                                                        &vertexInputCreateInfo;
-#pragma endregion
-
-#pragma region Input Assembly State
-            VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{};
-            inputAssemblyStateCreateInfo.sType = 
-                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-            inputAssemblyStateCreateInfo.topology =
-                                        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-            graphicsPipelineCreateInfo.pInputAssemblyState =
-                                                &inputAssemblyStateCreateInfo;
-#pragma endregion
-
-#pragma region Dynamic States
-            std::array dynamicStates =
-            {
-                VK_DYNAMIC_STATE_VIEWPORT,
-                VK_DYNAMIC_STATE_SCISSOR
-            };
+        m_Framebuffers.clear();
+
+        // the semaphores can still be waited on by a pending present
+        for (const PerImageData& data : m_PerImageData)
+            m_DeletionQueue->PushSemaphore(data.QueueReadySemaphore);
 
-            VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
-            dynamicStateCreateInfo.sType = 
-                        VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-            dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
-            dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
-            
-            graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
-#pragma endregion
-
-#pragma region Viewport State
-            VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
-            viewportStateCreateInfo.sType = 
-                        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-            // not setting the actual viewport and scissor states just how many 
-            // there will be
-            // that's because both are dynamic and will be specified later
-            viewportStateCreateInfo.scissorCount = 1;
-            viewportStateCreateInfo.viewportCount = 1;
-
-            graphicsPipelineCreateInfo.pViewportState = 
-                                                    &viewportStateCreateInfo;
-#pragma endregion
-
-#pragma region Rasterization State
-            VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
-            rasterizationStateCreateInfo.sType = 
-                    VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-
-            // if true, then the fragments outside the depth range 
-            // (the near and far planes) will be clamped, 
-            // else they will be discarded
-            // using this requires a gpu feature
-            rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
-            rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-
-            rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-            rasterizationStateCreateInfo.lineWidth = 1.0f;
-            rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-            rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-            rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
-
-            graphicsPipelineCreateInfo.pRasterizationState = 
-                                                &rasterizationStateCreateInfo;
-#pragma endregion
-
-#pragma region Multisample State
-            VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo{};
-            multisampleStateCreateInfo.sType = 
-                    VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-            multisampleStateCreateInfo.rasterizationSamples = 
-                                                        VK_SAMPLE_COUNT_1_BIT;
-
-            graphicsPipelineCreateInfo.pMultisampleState = 
-                                                &multisampleStateCreateInfo;
-#pragma endregion
-
-
-#pragma region Color Blending
-            VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
-
-            // specifies to which color components to write to
-            colorBlendAttachmentState.colorWriteMask =
-                VK_COLOR_COMPONENT_R_BIT
-                | VK_COLOR_COMPONENT_G_BIT
-                | VK_COLOR_COMPONENT_B_BIT
-                | VK_COLOR_COMPONENT_A_BIT;
-
-            colorBlendAttachmentState.blendEnable = VK_FALSE;
-            /* color blending op
-            VkPipelineColorBlendAttachmentState pipelineColorBlendAttachmentState2{};
-            pipelineColorBlendAttachmentState2.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-            pipelineColorBlendAttachmentState2.blendEnable = VK_TRUE;
-            pipelineColorBlendAttachmentState2.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-            pipelineColorBlendAttachmentState2.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-            pipelineColorBlendAttachmentState2.colorBlendOp = VK_BLEND_OP_ADD;
-            pipelineColorBlendAttachmentState2.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            pipelineColorBlendAttachmentState2.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            pipelineColorBlendAttachmentState2.alphaBlendOp = VK_BLEND_OP_ADD;
-            */
-
-
-            VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{};
-            colorBlendStateCreateInfo.sType = 
-                    VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-            colorBlendStateCreateInfo.attachmentCount = 1;
-            colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
-            colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
-
-            graphicsPipelineCreateInfo.pColorBlendState = 
-                                                    &colorBlendStateCreateInfo;
-#pragma  endregion
-
-#pragma region Pipeline Layout
-            VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-            pipelineLayoutCreateInfo.sType = 
-                                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            pipelineLayoutCreateInfo.setLayoutCount = 1;
-            pipelineLayoutCreateInfo.pSetLayouts = &m_CameraDescriptorSetLayout;
-
-            assert(vkCreatePipelineLayout(m_LogicalDevice->GetVulkanDevice(),
-                                          &pipelineLayoutCreateInfo, nullptr,
-                                          &m_PipelineLayout) == VK_SUCCESS);
-
-            graphicsPipelineCreateInfo.layout = m_PipelineLayout;
-#pragma endregion
-
-#pragma region Render Pass;
-            graphicsPipelineCreateInfo.renderPass = m_RenderPass;
-            graphicsPipelineCreateInfo.subpass = 0;
-#pragma endregion
-
-#pragma region Depth Stencil State
-            VkPipelineDepthStencilStateCreateInfo pipelineDepthStencilCreateInfo{};
-            pipelineDepthStencilCreateInfo.sType = 
-                    VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-            pipelineDepthStencilCreateInfo.depthTestEnable = VK_TRUE;
-            pipelineDepthStencilCreateInfo.depthWriteEnable = VK_TRUE;
-            pipelineDepthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
-
-            graphicsPipelineCreateInfo.pDepthStencilState = 
-                                            &pipelineDepthStencilCreateInfo;
-#pragma endregion
-
-        assert(vkCreateGraphicsPipelines(m_LogicalDevice->GetVulkanDevice(),
-                                         VK_NULL_HANDLE, 1,
-                                         &graphicsPipelineCreateInfo, nullptr,
-                                         &m_Pipeline) == VK_SUCCESS);
-
-        vkDestroyShaderModule(m_LogicalDevice->GetVulkanDevice(),
-                              vertexShaderModule, nullptr);
-        vkDestroyShaderModule(m_LogicalDevice->GetVulkanDevice(),
-                              fragmentShaderModule, nullptr);
+        m_PerImageData.clear();
     }
 
-    VkShaderModule RendererContext::CreateShader(
-        const std::vector<char>& shaderData)
+    void RendererContext::DrawFrame(const FramePacket& packet)
     {
-        VkShaderModuleCreateInfo shaderModuleCreateInfo{};
-        shaderModuleCreateInfo.sType = 
-                                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        shaderModuleCreateInfo.codeSize = shaderData.size();
-        shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(
-                                                            shaderData.data());
-
-        VkShaderModule shaderModule;
-        assert(vkCreateShaderModule(m_LogicalDevice->GetVulkanDevice(),
-                                    &shaderModuleCreateInfo, nullptr,
-                                    &shaderModule) == VK_SUCCESS);
-        return shaderModule;
+        if (BeginFrame(packet))
+            EndFrame(packet.Camera);
     }
 
-    void RendererContext::CreateVertexBuffer()
+    bool RendererContext::BeginFrame(const FramePacket& packet)
     {
-        VkDeviceSize bufferSize = sizeof(Vertex) * m_Vertices.size();
-        GPUBuffer stagingBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, bufferSize,
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        
-        void* data = stagingBuffer.MapMemory();
-        memcpy(data, m_Vertices.data(), sizeof(Vertex) * m_Vertices.size());
-        stagingBuffer.UnmapMemory();
+        OPTICK_EVENT();
+        m_FramePacer.WaitForNextFrame();
 
-        m_VertexBuffer = new GPUBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                       bufferSize,
-                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        ProcessShaderReloads();
 
-        CommandBuffer transferCommandBuffer = CreateStackCommandBuffer(m_TransientTransferCommandPool);
+        if (m_SwapchainOutOfDate)
+            RecreateSwapchain();
 
-        transferCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
-        transferCommandBuffer.CopyBuffer(&stagingBuffer, m_VertexBuffer, bufferSize);
-        transferCommandBuffer.End();
+        WaitForPresentation();
 
-        LogicalDevice* logicalDevice = GetLogicalDevice();
-        logicalDevice->SubmitImmediateCommands(transferCommandBuffer, logicalDevice->GetTransferQueue());
-    }
+        PerFrameData& currentFrameData = m_PerFrameData.at(m_FrameIndex);
+        QueueTimeline& graphicsTimeline = 
+                            m_LogicalDevice->GetTimeline(QueueType::Graphics);
+        graphicsTimeline.Wait(currentFrameData.TimelineValue);
 
-    //void RendererContext::CopyBuffer(
-    //    VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size)
-    //{
-    //    //VkCommandBuffer copyCommandBuffer =
-    //    //                AllocateCommandBuffer(m_TransientTransferCommandPool);
-    //    //BeginCommandBuffer(copyCommandBuffer, 
-    //    //                   VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        // the slot's command buffers are done executing, one pool reset
+        // recycles all of them
+        m_CommandBufferAllocator->ResetFrameSlot(m_FrameIndex);
 
-    //    //VkBufferCopy bufferCopy{};
-    //    //bufferCopy.size = size;
-    //    //vkCmdCopyBuffer(copyCommandBuffer, sourceBuffer, 
-    //    //                destinationBuffer, 1, &bufferCopy);
+        // everything released during or before the frame we just waited on
+        // is no longer in use
+        m_DeletionQueue->Flush(currentFrameData.FrameNumber);
+        m_MemoryTracker->Update();
 
-    //    //EndCommandBuffer(copyCommandBuffer);
+        VkResult acquireResult = m_Swapchain->AcquireNextImage(
+                    currentFrameData.SwapchainImageAcquireSemaphore,
+                    m_ImageIndex);
 
-    //    //// NOTE: using fences here would allow for multiple transfer operations to happen, potentially allowing the driver to optimize
-    //    //VkSubmitInfo submitInfo{};
-    //    //submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    //    //submitInfo.commandBufferCount = 1;
-    //    //submitInfo.pCommandBuffers = &copyCommandBuffer;
-    //    //assert(vkQueueSubmit(m_LogicalDevice->GetTransferQueue(), 1,
-    //    //                     &submitInfo, VK_NULL_HANDLE) == VK_SUCCESS);
+        // nothing was submitted for the slot yet so we can bail out and
+        // try again next frame with the new swapchain
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            RecreateSwapchain();
+            return false;
+        }
 
-    //    //vkQueueWaitIdle(m_LogicalDevice->GetTransferQueue());
+        assert(acquireResult == VK_SUCCESS ||
+               acquireResult == VK_SUBOPTIMAL_KHR);
 
-    //    //vkFreeCommandBuffers(m_LogicalDevice->GetVulkanDevice(),
-    //    //                     m_TransientTransferCommandPool, 1,
-    //    //                     &copyCommandBuffer);
-    //}
+        // the image can be acquired out of order, so it may still be
+        // rendered to by a different frame slot
+        PerImageData& currentImageData = m_PerImageData.at(m_ImageIndex);
+        graphicsTimeline.Wait(currentImageData.TimelineValue);
 
-    void RendererContext::CreateIndexBuffer()
+        currentFrameData.CommandBuffer = m_CommandBufferAllocator->Allocate(
+                                            m_FrameIndex, QueueType::Graphics);
+
+        // the uniforms are only read when the commands execute,
+        // so they can be written after recording
+        RecordCommandBuffer(m_ImageIndex, currentFrameData, packet.Draws);
+        return true;
+    }
+
+    void RendererContext::EndFrame(const CameraState& camera)
     {
-        VkDeviceSize bufferSize = sizeof(uint32_t) * m_Indices.size();
-        GPUBuffer stagingBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, bufferSize,
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        OPTICK_EVENT();
+        PerFrameData& currentFrameData = m_PerFrameData.at(m_FrameIndex);
+        PerImageData& currentImageData = m_PerImageData.at(m_ImageIndex);
 
-        void* data = stagingBuffer.MapMemory();
-        memcpy(data, m_Indices.data(), bufferSize);
-        stagingBuffer.UnmapMemory();
+        UpdateUniformBuffer(m_FrameIndex, camera);
 
-        m_IndexBuffer = new GPUBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                                      bufferSize,
-                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        QueueSubmission submission;
+        submission.CommandBuffers.push_back(currentFrameData.CommandBuffer);
+        submission.Waits.push_back({ 
+            currentFrameData.SwapchainImageAcquireSemaphore,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+        submission.Signals.push_back({ currentImageData.QueueReadySemaphore });
 
-        CommandBuffer transferCommandBuffer = CreateStackCommandBuffer(m_TransientTransferCommandPool);
+        uint64_t timelineValue = m_LogicalDevice->Submit(QueueType::Graphics,
+                                                         submission);
+        currentFrameData.TimelineValue = timelineValue;
+        currentImageData.TimelineValue = timelineValue;
 
-        transferCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
-        transferCommandBuffer.CopyBuffer(&stagingBuffer, m_IndexBuffer, bufferSize);
-        transferCommandBuffer.End();
+        ReportInputLatency(camera);
+        ReportSubmits();
+
+        currentFrameData.FrameNumber = m_DeletionQueue->GetCurrentFrame();
+        m_DeletionQueue->EndFrame();
 
-        LogicalDevice* logicalDevice = GetLogicalDevice();
+        uint64_t presentId = 0;
+        if (m_LogicalDevice->IsPresentWaitEnabled())
+            presentId = ++m_PresentId;
 
-        logicalDevice->SubmitImmediateCommands(transferCommandBuffer, logicalDevice->GetTransferQueue());
+        VkResult presentResult = m_Swapchain->Present(
+                            currentImageData.QueueReadySemaphore, m_ImageIndex,
+                            presentId);
+
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR ||
+            presentResult == VK_SUBOPTIMAL_KHR)
+            m_SwapchainOutOfDate = true;
+        else
+            assert(presentResult == VK_SUCCESS);
+
+        m_FrameIndex = (m_FrameIndex + 1) % m_FramesInFlight;
     }
 
-    void RendererContext::CreateCameraDescriptorSetLayout()
+    LatencyStatistics RendererContext::GetInputLatency() const
     {
-        VkDescriptorSetLayoutBinding descriptorSetLayoutBinding{};
-        descriptorSetLayoutBinding.binding = 0;
-        descriptorSetLayoutBinding.descriptorCount = 1;
-        descriptorSetLayoutBinding.descriptorType = 
-                                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-        VkDescriptorSetLayoutBinding textureDescriptorSetLayoutBinding{};
-        textureDescriptorSetLayoutBinding.binding = 1;
-        textureDescriptorSetLayoutBinding.descriptorCount = 1;
-        textureDescriptorSetLayoutBinding.stageFlags = 
-                                                VK_SHADER_STAGE_FRAGMENT_BIT;
-        textureDescriptorSetLayoutBinding.descriptorType = 
-                                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-
-        std::array descriptorSetLayoutBindings = {
-            descriptorSetLayoutBinding,
-            textureDescriptorSetLayoutBinding,
-        };
+        return m_InputLatency.GetStatistics();
+    }
 
-        VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
-        descriptorSetLayoutCreateInfo.sType = 
-                        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        descriptorSetLayoutCreateInfo.bindingCount = 
-                                            descriptorSetLayoutBindings.size();
-        descriptorSetLayoutCreateInfo.pBindings = 
-                                            descriptorSetLayoutBindings.data();
-
-        assert(vkCreateDescriptorSetLayout(
-                m_LogicalDevice->GetVulkanDevice(), 
-                &descriptorSetLayoutCreateInfo, nullptr, 
-                &m_CameraDescriptorSetLayout) == VK_SUCCESS);
+    void RendererContext::ReportInputLatency(const CameraState& camera)
+    {
+        LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+        m_InputLatency.AddSample(now - camera.SampleTime);
+
+#ifdef DEBUG
+        if (now - m_LastLatencyReport < std::chrono::seconds(5))
+            return;
+
+        m_LastLatencyReport = now;
+        LatencyStatistics statistics = m_InputLatency.GetStatistics();
+        std::cout << "Input to submit latency: avg "
+                  << statistics.AverageMilliseconds << "ms, min "
+                  << statistics.MinMilliseconds << "ms, max "
+                  << statistics.MaxMilliseconds << "ms\n";
+#endif
     }
 
-    static glm::vec3 position = { 0.0f, 0.0f, 4.0f };
-    static glm::vec3 front = { 0.0f, 0.0f, 1.0f };
-    static glm::vec3 right = { 1.0f, 0.0f, 0.0f };
-    static glm::vec3 up = { 0.0f, 1.0f, 0.0f };
-    static double lastMouseX, lastMouseY;
-    static bool first = true;
-    static double pitch = 0.0, yaw = -90.0;
+    void RendererContext::ReportSubmits()
+    {
+        uint64_t submitCount = 
+            m_LogicalDevice->GetSubmitBatcher().GetSubmitCount();
+        uint64_t frameSubmits = submitCount - m_LastSubmitCount;
+        m_LastSubmitCount = submitCount;
+        OPTICK_TAG("Submits", frameSubmits);
+
+        m_SubmitStatistics.Frames++;
+        m_SubmitStatistics.Submits += frameSubmits;
+        m_SubmitStatistics.MaxSubmits = std::max(
+            m_SubmitStatistics.MaxSubmits, frameSubmits);
+
+#ifdef DEBUG
+        LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+        if (now - m_LastSubmitReport < std::chrono::seconds(5))
+            return;
+
+        m_LastSubmitReport = now;
+        std::cout << "Queue submits per frame: avg "
+                  << static_cast<double>(m_SubmitStatistics.Submits) /
+                     m_SubmitStatistics.Frames
+                  << ", max " << m_SubmitStatistics.MaxSubmits << '\n';
+        m_SubmitStatistics = {};
+#endif
+    }
 
-    static glm::mat4 testlookat(
-        glm::vec3 position, glm::vec3 direction, glm::vec3 worldUp)
+    void RendererContext::CreateGraphicsPipeline()
     {
-        glm::vec3 front = glm::normalize(position - direction);
-        glm::vec3 right = glm::normalize(
-                            glm::cross(direction, 
-                                       glm::normalize(worldUp)));
+        OPTICK_EVENT();
+        GraphicsPipelineCreateInfo createInfo{};
+        createInfo.VertexShaderPath = VertexShaderPath;
+        createInfo.FragmentShaderPath = FragmentShaderPath;
+        createInfo.RenderPass = m_RenderPass;
+
+        m_PipelineLibrary = new PipelineLibrary(
+                                        "assets/shaders/cache/pipelines.bin");
+        m_GraphicsPipeline = m_PipelineLibrary->Add("Basic", createInfo);
+        m_PipelineLibrary->Precompile("Basic", CubeVariants);
+        m_GraphicsPipeline->SetFallbackVariant(PipelineVariantKey::All());
+
+        m_ShaderWatcher->Watch(VertexShaderPath, ShaderStage::Vertex);
+        m_ShaderWatcher->Watch(FragmentShaderPath, ShaderStage::Fragment);
+    }
 
-        glm::vec3 up =  glm::normalize(glm::cross(front, right));
-        glm::mat4 directionMat = glm::mat4(1.0f);
-        directionMat[0][0] = right.x;
-        directionMat[1][0] = right.y;
-        directionMat[2][0] = right.z;
+    void RendererContext::CreateComputePipeline()
+    {
+        OPTICK_EVENT();
+        ComputePipelineCreateInfo createInfo{};
+        createInfo.ShaderPath = CubeIndicesShaderPath;
 
-        directionMat[0][1] = up.x;
-        directionMat[1][1] = up.y;
-        directionMat[2][1] = up.z;
+        m_PipelineLibrary->AddCompute("CubeIndices", createInfo);
+        m_ShaderWatcher->Watch(CubeIndicesShaderPath, ShaderStage::Compute);
+    }
 
-        directionMat[0][2] = front.x;
-        directionMat[1][2] = front.y;
-        directionMat[2][2] = front.z;
+    void RendererContext::ProcessShaderReloads()
+    {
+        OPTICK_EVENT();
+        std::vector<std::filesystem::path> recompiledShaders =
+                                    m_ShaderWatcher->GetRecompiledShaders();
 
-        glm::mat4 positionMat(1.0f);
-        positionMat[3][0] = -position.x;
-        positionMat[3][1] = -position.y;
-        positionMat[3][2] = -position.z;
+        // the watcher already compiled the shaders so this only
+        // creates the pipelines
+        if (!recompiledShaders.empty())
+            m_PipelineLibrary->Rebuild(recompiledShaders);
 
+        m_PipelineLibrary->Update();
+    }
 
-        return directionMat * positionMat;
+    void RendererContext::CreateVertexBuffer()
+    {
+        OPTICK_EVENT();
+        m_VertexBuffer = CreateStaticBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            m_Vertices.data(), sizeof(Vertex) * m_Vertices.size(),
+            MemoryCategory::Vertex,
+            { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
+              VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT });
     }
 
-    void RendererContext::UpdateUniformBuffer(uint32_t frameIndex)
+    GPUBuffer* RendererContext::CreateStaticBuffer(VkBufferUsageFlags usage,
+        const void* data, VkDeviceSize size, MemoryCategory category,
+        const ResourceAccess& firstUse)
     {
-        static auto startTime = std::chrono::high_resolution_clock::now();
-        auto currentTime = std::chrono::high_resolution_clock::now();
+        OPTICK_EVENT();
+        OPTICK_TAG("Size", size);
+
+        // integrated gpus and discrete ones with resizable bar can take 
+        // the data directly, no staging buffer or copy needed, as long as
+        // the buffer may be bound to that memory
+        if (m_MemoryTracker->CanUse(MemoryStrategy::DeviceLocalMappable, 
+                                    size, GPUBuffer::GetMemoryTypeBits(usage)))
+        {
+            GPUBuffer* buffer = new GPUBuffer(usage, size,
+                m_MemoryTracker->GetMemoryProperties(
+                                        MemoryStrategy::DeviceLocalMappable),
+                category);
+
+            // coherent, visible to the gpu once the next submit happens
+            memcpy(buffer->MapMemory(), data, size);
+            buffer->UnmapMemory();
+            return buffer;
+        }
+
+        GPUBuffer stagingBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size,
+            m_MemoryTracker->GetMemoryProperties(MemoryStrategy::Upload),
+            MemoryCategory::Staging);
+
+        memcpy(stagingBuffer.MapMemory(), data, size);
+        stagingBuffer.UnmapMemory();
 
-        float time = std::chrono::duration<float>(startTime - currentTime)
-                                                                    .count();
+        GPUBuffer* buffer = new GPUBuffer(
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, size,
+            m_MemoryTracker->GetMemoryProperties(MemoryStrategy::DeviceOnly),
+            category);
 
-        GLFWwindow* window = 
-                            Application::Get()->GetWindow()->GetNativeWindow();
+        CommandBuffer& transferCommandBuffer = 
+            *m_CommandBufferAllocator->AllocateImmediate(QueueType::Transfer);
 
-        glm::vec3 velocity = {0.0f, 0.0f, 0.0f};
+        transferCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
+        transferCommandBuffer.CopyBuffer(&stagingBuffer, buffer, size);
+        transferCommandBuffer.ReleaseOwnership(buffer, 
+            QueueType::Transfer, QueueType::Graphics,
+            { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT });
+        transferCommandBuffer.End();
 
-        if (glfwGetKey(window, GLFW_KEY_W))
-            velocity += front;
-        else if (glfwGetKey(window, GLFW_KEY_S))
-            velocity -= front;
+        QueueUpload(QueueType::Transfer, transferCommandBuffer, 
+            buffer->IsOwnershipTransferPending(), firstUse.Stages,
+            [buffer, firstUse](CommandBuffer& commandBuffer)
+            {
+                commandBuffer.AcquireOwnership(buffer, firstUse);
+            });
 
-        if (glfwGetKey(window, GLFW_KEY_A))
-            velocity -= right;
-        else if(glfwGetKey(window, GLFW_KEY_D))
-            velocity += right;
+        return buffer;
+    }
 
-        if(glfwGetKey(window, GLFW_KEY_Q))
-            velocity -= up;
-        else if (glfwGetKey(window, GLFW_KEY_E))
-            velocity += up;
+    void RendererContext::QueueUpload(QueueType queue,
+        const CommandBuffer& commandBuffer, bool acquireNeeded,
+        VkPipelineStageFlags firstUseStages,
+        const std::function<void(CommandBuffer&)>& recordAcquire)
+    {
+        // the uploads share a submit info, none of them wait on anything
+        QueueSubmission submission;
+        submission.CommandBuffers.push_back(&commandBuffer);
+        m_LogicalDevice->GetSubmitBatcher().Enqueue(queue, submission);
 
-        if(velocity != glm::vec3(0.0f))
-            velocity = glm::normalize(velocity);
+        if (!acquireNeeded)
+            return;
 
-        position += velocity * Application::Get()->GetDeltaTime() * 6.0f;
-        
-        double mouseX, mouseY;
-        glfwGetCursorPos(window, &mouseX, &mouseY);
+        m_PendingAcquires.push_back(recordAcquire);
+        m_PendingAcquireStages.at(static_cast<size_t>(queue)) |= 
+                                                            firstUseStages;
+    }
+
+    void RendererContext::FlushUploads()
+    {
+        OPTICK_EVENT();
+        SubmitBatcher& batcher = m_LogicalDevice->GetSubmitBatcher();
+
+        // the graphics queue waits for the queues it acquires from, the
+        // host for the others
+        std::vector<SemaphoreWait> acquireWaits;
+        std::vector<std::pair<const QueueTimeline*, uint64_t>> hostWaits;
+        for (QueueType queue : { QueueType::Transfer, QueueType::Compute })
+        {
+            uint64_t value = batcher.Flush(queue);
+            const QueueTimeline& timeline = m_LogicalDevice->GetTimeline(queue);
+            VkPipelineStageFlags stages = 
+                        m_PendingAcquireStages.at(static_cast<size_t>(queue));
+            if (stages != 0)
+                acquireWaits.push_back({ timeline.GetSemaphore(), stages,
+                                         value });
+            else
+                hostWaits.push_back({ &timeline, value });
+        }
 
-        if(first)
+        if (!m_PendingAcquires.empty())
         {
-            lastMouseX = mouseX;
-            lastMouseY = mouseY;
-            first = false;
+            // one command buffer acquires everything the other queues
+            // released
+            CommandBuffer& graphicsCommandBuffer = 
+                *m_CommandBufferAllocator->AllocateImmediate(
+                                                        QueueType::Graphics);
+            graphicsCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
+            for (const auto& recordAcquire : m_PendingAcquires)
+                recordAcquire(graphicsCommandBuffer);
+            graphicsCommandBuffer.End();
+
+            // the gpu orders the acquires after the releases, so the host
+            // only has to wait for the graphics queue
+            QueueSubmission graphicsSubmission;
+            graphicsSubmission.CommandBuffers.push_back(
+                                                    &graphicsCommandBuffer);
+            graphicsSubmission.Waits = std::move(acquireWaits);
+            uint64_t graphicsValue = m_LogicalDevice->Submit(
+                                    QueueType::Graphics, graphicsSubmission);
+            hostWaits.push_back({ 
+                &m_LogicalDevice->GetTimeline(QueueType::Graphics),
+                graphicsValue });
         }
 
-        double xoffset = (mouseX - lastMouseX) * 0.1f;
-        double yoffset = (mouseY - lastMouseY) * 0.1f;
-        lastMouseX = mouseX;
-        lastMouseY = mouseY;
+        for (const auto& [timeline, value] : hostWaits)
+            timeline->Wait(value);
+        m_CommandBufferAllocator->ResetImmediate();
 
-        pitch += yoffset;
-        yaw += xoffset;
+        m_PendingAcquires.clear();
+        m_PendingAcquireStages = {};
+    }
 
-        if (pitch > 89.0f)
-            pitch = 89.0f;
-        if (pitch < -89.0f)
-            pitch = -89.0f;
+    //void RendererContext::CopyBuffer(
+    //    VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size)
+    //{
+    //    //VkCommandBuffer copyCommandBuffer =
+    //    //                AllocateCommandBuffer(m_TransientTransferCommandPool);
+    //    //BeginCommandBuffer(copyCommandBuffer, 
+    //    //                   VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-        glm::vec3 direction = { 0.0f, 0.0f, 0.0f };
-        direction.x = glm::cos(glm::radians(yaw)) * 
-                                                glm::cos(glm::radians(pitch));
-        direction.y = glm::sin(glm::radians(pitch));
-        direction.z = glm::sin(glm::radians(yaw)) * 
-                                                glm::cos(glm::radians(pitch));
-        front = glm::normalize(direction);
+    //    //VkBufferCopy bufferCopy{};
+    //    //bufferCopy.size = size;
+    //    //vkCmdCopyBuffer(copyCommandBuffer, sourceBuffer, 
+    //    //                destinationBuffer, 1, &bufferCopy);
 
-        if (glfwGetKey(window, GLFW_KEY_R))
-        {
-            position = { 0.0f, 0.0f, 4.0f };
-            direction = { 0.0f, 0.0f, -1.0f };
-        }
+    //    //EndCommandBuffer(copyCommandBuffer);
+
+    //    //// NOTE: using fences here would allow for multiple transfer operations to happen, potentially allowing the driver to optimize
+    //    //VkSubmitInfo submitInfo{};
+    //    //submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    //    //submitInfo.commandBufferCount = 1;
+    //    //submitInfo.pCommandBuffers = &copyCommandBuffer;
+    //    //assert(vkQueueSubmit(m_LogicalDevice->GetTransferQueue(), 1,
+    //    //                     &submitInfo, VK_NULL_HANDLE) == VK_SUCCESS);
+
+    //    //vkQueueWaitIdle(m_LogicalDevice->GetTransferQueue());
+
+    //    //vkFreeCommandBuffers(m_LogicalDevice->GetVulkanDevice(),
+    //    //                     m_TransientTransferCommandPool, 1,
+    //    //                     &copyCommandBuffer);
+    //}
+
+    void RendererContext::CreateIndexBuffer()
+    {
+        OPTICK_EVENT();
+        VkDeviceSize size = sizeof(uint32_t) * m_CubeCount * CubeIndexCount;
+        m_IndexBuffer = new GPUBuffer(
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, size,
+            m_MemoryTracker->GetMemoryProperties(MemoryStrategy::DeviceOnly),
+            MemoryCategory::Index);
+
+        // every face uses the same pattern, so the compute queue writes
+        // the indices straight into device local memory
+        ComputePipeline* pipeline = 
+                                m_PipelineLibrary->GetCompute("CubeIndices");
+        VkDescriptorSetLayout setLayout = pipeline->GetDescriptorSetLayout(0);
 
-        right = glm::normalize(glm::cross(front, {0.0f, 1.0f, 0.0f}));
-        up = glm::normalize(glm::cross(right, front));
+        VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+        descriptorSetAllocateInfo.sType = 
+                                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descriptorSetAllocateInfo.descriptorPool = m_DescriptorPool;
+        descriptorSetAllocateInfo.descriptorSetCount = 1;
+        descriptorSetAllocateInfo.pSetLayouts = &setLayout;
 
+        // freed with the pool
+        VkDescriptorSet descriptorSet;
+        assert(GetDeviceDispatch().vkAllocateDescriptorSets(
+                                        m_LogicalDevice->GetVulkanDevice(), 
+                                        &descriptorSetAllocateInfo, 
+                                        &descriptorSet) == VK_SUCCESS);
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_IndexBuffer->GetVulkanBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = size;
+
+        VkWriteDescriptorSet writeDescriptorSet{};
+        writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSet.dstSet = descriptorSet;
+        writeDescriptorSet.dstBinding = 0;
+        writeDescriptorSet.dstArrayElement = 0;
+        writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writeDescriptorSet.descriptorCount = 1;
+        writeDescriptorSet.pBufferInfo = &bufferInfo;
+
+        GetDeviceDispatch().vkUpdateDescriptorSets(
+                                        m_LogicalDevice->GetVulkanDevice(), 
+                                        1, &writeDescriptorSet, 0, nullptr);
+
+        IndexGenerationData generationData{};
+        generationData.FaceCount = m_CubeCount * CubeFaceCount;
+
+        CommandBuffer& computeCommandBuffer = 
+            *m_CommandBufferAllocator->AllocateImmediate(QueueType::Compute);
+        computeCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
+        computeCommandBuffer.BindPipeline(pipeline->GetPipeline(),
+                                          VK_PIPELINE_BIND_POINT_COMPUTE);
+        computeCommandBuffer.BindDescriptorSets(pipeline->GetLayout(),
+            descriptorSet, VK_PIPELINE_BIND_POINT_COMPUTE);
+        computeCommandBuffer.PushConstants(pipeline->GetLayout(),
+            pipeline->GetReflection(), generationData);
+        computeCommandBuffer.Dispatch(
+            (generationData.FaceCount + CubeIndicesGroupSize - 1) / 
+            CubeIndicesGroupSize);
+        computeCommandBuffer.ReleaseOwnership(m_IndexBuffer, 
+            QueueType::Compute, QueueType::Graphics,
+            { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+              VK_ACCESS_SHADER_WRITE_BIT });
+        computeCommandBuffer.End();
+
+        ResourceAccess firstUse{ VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
+                                 VK_ACCESS_INDEX_READ_BIT };
+        QueueUpload(QueueType::Compute, computeCommandBuffer,
+            m_IndexBuffer->IsOwnershipTransferPending(), firstUse.Stages,
+            [this, firstUse](CommandBuffer& commandBuffer)
+            {
+                commandBuffer.AcquireOwnership(m_IndexBuffer, firstUse);
+            });
+    }
+
+    void RendererContext::UpdateUniformBuffer(uint32_t frameIndex,
+                                              const CameraState& camera)
+    {
+        OPTICK_EVENT();
         CameraData cameraData;
 
-        cameraData.View = glm::lookAt(position, position + front, up);
+        cameraData.View = camera.GetViewMatrix();
         auto swapchainExtent = m_Swapchain->GetExtent();
-        cameraData.Projection = glm::perspective(
-                                    glm::radians(fov), 
+        cameraData.Projection = camera.GetProjectionMatrix(
                                     swapchainExtent.width / 
-                                    (float)swapchainExtent.height, 
-                                    0.1f, 50.0f);
+                                    (float)swapchainExtent.height);
         
         const PerFrameData& data = m_PerFrameData.at(frameIndex);
         memcpy(data.CameraUniformBufferMemory, &cameraData, sizeof(CameraData));
@@ -1124,6 +1204,7 @@ namespace LearningVulkan
 
     void RendererContext::CreateDescriptorPool()
     {
+        OPTICK_EVENT();
         VkDescriptorPoolSize descriptorPoolSize;
         descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         descriptorPoolSize.descriptorCount = m_PerFrameData.size();
@@ -1133,9 +1214,15 @@ namespace LearningVulkan
                                     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         textureDescriptorPoolSize.descriptorCount = m_PerFrameData.size();
 
+        // the index generation's output
+        VkDescriptorPoolSize storageDescriptorPoolSize;
+        storageDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        storageDescriptorPoolSize.descriptorCount = 1;
+
         std::array descriptorPoolSizes = {
             descriptorPoolSize,
             textureDescriptorPoolSize,
+            storageDescriptorPoolSize,
         };
 
         VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
@@ -1143,9 +1230,9 @@ namespace LearningVulkan
                                 VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
         descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-        descriptorPoolCreateInfo.maxSets = m_PerFrameData.size();
+        descriptorPoolCreateInfo.maxSets = m_PerFrameData.size() + 1;
 
-        assert(vkCreateDescriptorPool(m_LogicalDevice->GetVulkanDevice(), 
+        assert(GetDeviceDispatch().vkCreateDescriptorPool(m_LogicalDevice->GetVulkanDevice(), 
                                       &descriptorPoolCreateInfo, 
                                       nullptr, 
                                       &m_DescriptorPool) == VK_SUCCESS);
@@ -1155,8 +1242,10 @@ namespace LearningVulkan
 
     void RendererContext::CreateDescriptorSets()
     {
+        OPTICK_EVENT();
         std::vector descriptorSetLayouts(m_PerFrameData.size(), 
-                                         m_CameraDescriptorSetLayout);
+                                m_GraphicsPipeline->GetDescriptorSetLayout(0));
+        std::vector<VkDescriptorSet> descriptorSets(m_PerFrameData.size());
 
         VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
         descriptorSetAllocateInfo.sType = 
@@ -1166,14 +1255,14 @@ namespace LearningVulkan
                                                 descriptorSetLayouts.size();
         descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
 
-        m_DescriptorSets.resize(m_PerFrameData.size());
-        assert(vkAllocateDescriptorSets(m_LogicalDevice->GetVulkanDevice(), 
+        assert(GetDeviceDispatch().vkAllocateDescriptorSets(m_LogicalDevice->GetVulkanDevice(), 
                                         &descriptorSetAllocateInfo, 
-                                        m_DescriptorSets.data()) == VK_SUCCESS);
+                                        descriptorSets.data()) == VK_SUCCESS);
 
         for (size_t i = 0; i < m_PerFrameData.size(); i++)
         {
-            const PerFrameData& perframeData = m_PerFrameData.at(i);
+            PerFrameData& perframeData = m_PerFrameData.at(i);
+            perframeData.CameraDescriptorSet = descriptorSets.at(i);
             VkDescriptorBufferInfo bufferInfo{};
             bufferInfo.buffer = 
                             perframeData.CameraUniformBuffer->GetVulkanBuffer();
@@ -1189,7 +1278,7 @@ namespace LearningVulkan
 
             VkWriteDescriptorSet writeDescriptorSet{};
             writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            writeDescriptorSet.dstSet = m_DescriptorSets.at(i);
+            writeDescriptorSet.dstSet = perframeData.CameraDescriptorSet;
             writeDescriptorSet.dstBinding = 0;
             writeDescriptorSet.dstArrayElement = 0;
 
@@ -1202,7 +1291,7 @@ namespace LearningVulkan
             VkWriteDescriptorSet textureWriteDescriptorSet{};
             textureWriteDescriptorSet.sType = 
                                         VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            textureWriteDescriptorSet.dstSet = m_DescriptorSets.at(i);
+            textureWriteDescriptorSet.dstSet = perframeData.CameraDescriptorSet;
             textureWriteDescriptorSet.dstBinding = 1;
             textureWriteDescriptorSet.dstArrayElement = 0;
             textureWriteDescriptorSet.descriptorType = 
@@ -1212,7 +1301,7 @@ namespace LearningVulkan
             writeDescriptorSets[1] = textureWriteDescriptorSet;
 
 
-            vkUpdateDescriptorSets(m_LogicalDevice->GetVulkanDevice(), 
+            GetDeviceDispatch().vkUpdateDescriptorSets(m_LogicalDevice->GetVulkanDevice(), 
                                    writeDescriptorSets.size(), 
                                    writeDescriptorSets.data(), 0, nullptr);
         }
@@ -1220,6 +1309,7 @@ namespace LearningVulkan
 
     void RendererContext::CreateTexture()
     {
+        OPTICK_EVENT();
         int width, height, channels;
         stbi_uc* imageData = stbi_load("assets/test.png", &width, &height, 
                                        &channels, STBI_rgb_alpha);
@@ -1228,44 +1318,73 @@ namespace LearningVulkan
 
         VkDeviceSize imageSize = width * height * 4;
 
-        GPUBuffer stagingBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, imageSize, 
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data = stagingBuffer.MapMemory();
-        memcpy(data, imageData, imageSize);
-        stagingBuffer.UnmapMemory();
-
-        stbi_image_free(imageData);
-
         ImageCreateInfo imageCreateInfo;
         imageCreateInfo.Width = width;
         imageCreateInfo.Height = height;
         imageCreateInfo.Format = VK_FORMAT_R8G8B8A8_SRGB;
         imageCreateInfo.Tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageCreateInfo.Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageCreateInfo.Usage = VK_IMAGE_USAGE_SAMPLED_BIT;
         imageCreateInfo.MemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
         imageCreateInfo.AspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
 
-        m_TestImage = new Image(imageCreateInfo);
+        // with host image copy the cpu writes the pixels and does the
+        // layout transition, no staging memory or queue submits needed
+        if (m_LogicalDevice->SupportsHostImageCopy(imageCreateInfo.Format,
+                imageCreateInfo.Tiling, imageCreateInfo.Usage,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+        {
+            imageCreateInfo.Usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+            m_TestImage = new Image(imageCreateInfo);
+            m_TestImage->CopyFromHost(imageData, 
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+            stbi_image_free(imageData);
+            CreateTextureSampler();
+            return;
+        }
+
+        // optimal tiling images can't be mapped, so everything else goes
+        // through staging
+        GPUBuffer stagingBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, imageSize, 
+            m_MemoryTracker->GetMemoryProperties(MemoryStrategy::Upload),
+            MemoryCategory::Staging);
+
+        void* data = stagingBuffer.MapMemory();
+        memcpy(data, imageData, imageSize);
+        stagingBuffer.UnmapMemory();
 
-        LogicalDevice* logicalDevice = GetLogicalDevice();
+        stbi_image_free(imageData);
+
+        imageCreateInfo.Usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        m_TestImage = new Image(imageCreateInfo);
 
-        CommandBuffer transferCommandBuffer = CreateStackCommandBuffer(m_TransientTransferCommandPool);
+        CommandBuffer& transferCommandBuffer = 
+            *m_CommandBufferAllocator->AllocateImmediate(QueueType::Transfer);
         transferCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
         transferCommandBuffer.TransitionLayout(m_TestImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
         transferCommandBuffer.CopyBufferToImage(&stagingBuffer, m_TestImage, width, height);
+        // the transition to the read only layout is part of the transfer
+        transferCommandBuffer.ReleaseOwnership(m_TestImage, 
+            QueueType::Transfer, QueueType::Graphics,
+            { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT },
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         transferCommandBuffer.End();
 
-        logicalDevice->SubmitImmediateCommands(transferCommandBuffer, logicalDevice->GetTransferQueue());
-
-        CommandBuffer graphicsCommandBuffer = CreateStackCommandBuffer(m_TransientGraphicsCommandPool);
-        graphicsCommandBuffer.Begin(CommandBufferUsage::OneTimeSubmit);
-        graphicsCommandBuffer.TransitionLayout(m_TestImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        graphicsCommandBuffer.End();
+        QueueUpload(QueueType::Transfer, transferCommandBuffer, 
+            m_TestImage->IsOwnershipTransferPending(),
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            [this](CommandBuffer& commandBuffer)
+            {
+                commandBuffer.AcquireOwnership(m_TestImage, 
+                    { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 
+                      VK_ACCESS_SHADER_READ_BIT });
+            });
 
-        logicalDevice->SubmitImmediateCommands(graphicsCommandBuffer, logicalDevice->GetGraphicsQueue());
+        CreateTextureSampler();
+    }
 
+    void RendererContext::CreateTextureSampler()
+    {
         SamplerCreateInfo samplerCreateInfo{
             .MagFilter = TextureFilter::Nearest,
             .MinFilter = TextureFilter::Nearest,
@@ -1310,18 +1429,7 @@ namespace LearningVulkan
         m_Vertices.push_back({ .Position = transformMatrix * glm::vec4{ -0.5f, 0.5f,  0.5f, 1.0f }, .Color = { 1.0, 1.0, 1.0 }, .TextureCoordinates = {1.0f, 0.0f}, });
         m_Vertices.push_back({ .Position = transformMatrix * glm::vec4{  0.5f, 0.5f,  0.5f, 1.0f }, .Color = { 1.0, 1.0, 1.0 }, .TextureCoordinates = {1.0f, 1.0f}, });
 
-        size_t previousSize = m_Indices.size();
-        m_Indices.resize( previousSize + 36);
-        for (uint32_t i = 0; i < 6; ++i)
-        {
-            m_Indices[previousSize + (i * 6 + 0)] = currentIndex + 0;
-            m_Indices[previousSize + (i * 6 + 1)] = currentIndex + 1;
-            m_Indices[previousSize + (i * 6 + 2)] = currentIndex + 2;
-            m_Indices[previousSize + (i * 6 + 3)] = currentIndex + 2;
-            m_Indices[previousSize + (i * 6 + 4)] = currentIndex + 3;
-            m_Indices[previousSize + (i * 6 + 5)] = currentIndex + 0;
-            currentIndex +=  4;
-        }
+        m_CubeCount++;
 
     }
 }
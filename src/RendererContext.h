@@ -5,7 +5,23 @@
 #include "Swapchain.h"
 #include "Framebuffer.h"
 #include "GPUBuffer.h"
-
+#include "DeletionQueue.h"
+#include "FramePacer.h"
+#include "LatencyTracker.h"
+#include "ShaderCompiler.h"
+#include "ShaderWatcher.h"
+#include "GraphicsPipeline.h"
+#include "ComputePipeline.h"
+#include "PipelineLibrary.h"
+#include "LayoutCache.h"
+#include "MemoryTracker.h"
+#include "FramePacket.h"
+#include "CommandBufferAllocator.h"
+#include "SubmitBatcher.h"
+#include "VulkanFunctions.h"
+
+#include <array>
+#include <functional>
 #include <string_view>
 #include <vector>
 
@@ -18,34 +34,59 @@ namespace LearningVulkan
     // TODO: move inside render context
     struct PerFrameData
     {
-        CommandBuffer* CommandBuffer;
+        // handed out again every frame, owned by the allocator
+        CommandBuffer* CommandBuffer = nullptr;
         //VkCommandBuffer CommandBuffer;
-        VkCommandPool CommandPool;
-        VkFence PresentFence;
+        // the graphics timeline value of the slot's last submit
+        uint64_t TimelineValue = 0;
+        // binary, acquire can't signal timeline semaphores
         VkSemaphore SwapchainImageAcquireSemaphore;
-        VkSemaphore QueueReadySemaphore;
 
         // uniform buffer:
         GPUBuffer* CameraUniformBuffer;
         void* CameraUniformBufferMemory;
+        VkDescriptorSet CameraDescriptorSet;
+
+        // the deletion queue frame that was last submitted from this slot
+        uint64_t FrameNumber = 0;
+    };
+
+    struct PerImageData
+    {
+        // the graphics timeline value of the last frame that rendered to 
+        // this image, images can be acquired out of order so we have to 
+        // wait on it before reusing the image
+        uint64_t TimelineValue = 0;
+        // signaled when rendering to the image is done, waited on by 
+        // present which only takes binary semaphores
+        VkSemaphore QueueReadySemaphore;
     };
 
     class RendererContext 
     {
     public:
-        RendererContext(std::string_view applicationName);
+        RendererContext(std::string_view applicationName,
+                        uint32_t framesInFlight = 2);
         ~RendererContext();
 
         static VkInstance GetVulkanInstance();
+        // entry points of the instance and of the logical device, calls
+        // through them skip the loader's trampolines
+        static const InstanceDispatch& GetInstanceDispatch();
+        static const DeviceDispatch& GetDeviceDispatch();
+        // the api version the instance was created with
+        static uint32_t GetInstanceVersion();
         static VkSurfaceKHR GetVulkanSurface();
 
-        static VkCommandPool GetTransientTransferCommandPool();
-
-        static VkCommandPool GetTransientGraphicsCommandPool();
+        static CommandBufferAllocator* GetCommandBufferAllocator();
 
         const PhysicalDevice* GetPhysicalDevice() const;
 
         static LogicalDevice* GetLogicalDevice();
+        static DeletionQueue* GetDeletionQueue();
+        static MemoryTracker* GetMemoryTracker();
+        static ShaderCompiler* GetShaderCompiler();
+        static LayoutCache* GetLayoutCache();
         Swapchain* GetSwapchain() const;
         VkRenderPass GetRenderPass() const;
 
@@ -55,65 +96,141 @@ namespace LearningVulkan
         const PerFrameData& GetPerFrameData(size_t index) const;
 
         size_t GetPerFrameDataSize() const;
-
-        const VkPipeline& GetGraphicsPipeline() const;
-        void DrawFrame();
-
-        static CommandBuffer CreateStackCommandBuffer(
-            VkCommandPool commandPool);
-
-        static CommandBuffer* CreateCommandBuffer(
-            VkCommandPool commandPool);
+        uint32_t GetFramesInFlight() const;
+
+        GraphicsPipeline* GetGraphicsPipeline() const;
+        // meshes that draw items can refer to
+        uint32_t GetCubeCount() const;
+        // all of them are precompiled, so drawing with one never falls back
+        static const std::vector<PipelineVariantKey>& GetCubeVariants();
+
+        // waits for the frame slot, acquires an image and records the
+        // packet's draws, returns false if the frame has to be skipped
+        bool BeginFrame(const FramePacket& packet);
+        // writes the camera uniforms and submits
+        void EndFrame(const CameraState& camera);
+        void DrawFrame(const FramePacket& packet);
+
+        // time between the last input poll and the frame's submission,
+        // can be read from any thread
+        LatencyStatistics GetInputLatency() const;
+
+        // NOTE: render thread only, other threads go through
+        // RenderThread::SetFramePacing
+        void SetFramePacing(FramePacingMode mode,
+                            double targetFrameRate = 60.0);
+        FramePacingMode GetFramePacing() const;
     private:
         static void CreateVulkanInstance(std::string_view applicationName);
         static bool CheckLayersAvailability();
         void SetupDebugMessenger();
         static void CreateSurface();
         void CreateRenderPass();
+        void InitGpuProfiling();
 
-        VkCommandPool CreateCommandPool(
-            VkCommandPoolCreateFlags commandPoolFlags, 
-            uint32_t queueFamilyIndex) const;
-
-        void RecordCommandBuffer(
-            uint32_t imageIndex, CommandBuffer& commandBuffer);
+        void RecordCommandBuffer(uint32_t imageIndex,
+                                 const PerFrameData& frameData,
+                                 const std::vector<DrawItem>& draws);
         static void CreateSyncObjects(
-            VkSemaphore& swapchainImageAcquireSemaphore,
-            VkSemaphore& queueReadySemaphore,
-            VkFence& presentFence);
+            VkSemaphore& swapchainImageAcquireSemaphore);
 
         void CreatePerFrameObjects(uint32_t frameIndex);
+        void CreatePerImageObjects();
+        void DestroyPerImageObjects();
+        void RecreateSwapchain();
+        void WaitForPresentation();
+        void ReportInputLatency(const CameraState& camera);
+        // counts the frame's vkQueueSubmit calls, each one costs a trip
+        // into the kernel on some drivers
+        void ReportSubmits();
         void CreateGraphicsPipeline();
-        static VkShaderModule CreateShader(
-            const std::vector<char>& shaderData);
+        void CreateComputePipeline();
+        // rebuilds the pipelines whose shaders changed on disk and puts
+        // finished background compiles into use
+        void ProcessShaderReloads();
+        // batches the commands creating a static resource on the transfer
+        // or compute queue and, if they released it to the graphics queue,
+        // keeps the acquire for FlushUploads
+        void QueueUpload(QueueType queue, const CommandBuffer& commandBuffer,
+            bool acquireNeeded, VkPipelineStageFlags firstUseStages,
+            const std::function<void(CommandBuffer&)>& recordAcquire);
+        // submits the batched uploads and all their acquires at once, then
+        // waits and recycles the immediate command buffers
+        void FlushUploads();
+        // a buffer the gpu only reads, written in place when device local
+        // memory is mappable, otherwise staged through the transfer queue
+        GPUBuffer* CreateStaticBuffer(VkBufferUsageFlags usage,
+            const void* data, VkDeviceSize size, MemoryCategory category,
+            const ResourceAccess& firstUse);
         void CreateVertexBuffer();
+        // generated by a compute shader
         void CreateIndexBuffer();
-        void CreateCameraDescriptorSetLayout();
-        void UpdateUniformBuffer(uint32_t frameIndex);
+        void UpdateUniformBuffer(uint32_t frameIndex,
+                                 const CameraState& camera);
         void CreateDescriptorPool();
         void CreateDescriptorSets();
         void CreateTexture();
+        void CreateTextureSampler();
         
         void AddCube(
             const glm::mat4& transformMatrix = glm::mat4(1.0f));
 
     private:
-        static VkCommandPool m_TransientTransferCommandPool;
-        static VkCommandPool m_TransientGraphicsCommandPool;
+        static CommandBufferAllocator* m_CommandBufferAllocator;
         static VkInstance m_Instance;
+        static InstanceDispatch m_InstanceDispatch;
+        static uint32_t m_InstanceVersion;
         VkDebugUtilsMessengerEXT m_DebugMessenger;
         static VkSurfaceKHR m_Surface;
         static LogicalDevice* m_LogicalDevice;
+        static DeletionQueue* m_DeletionQueue;
+        static MemoryTracker* m_MemoryTracker;
+        static ShaderCompiler* m_ShaderCompiler;
+        static LayoutCache* m_LayoutCache;
+        ShaderWatcher* m_ShaderWatcher;
         VkRenderPass m_RenderPass;
         PhysicalDevice* m_PhysicalDevice;
         Swapchain* m_Swapchain;
+        VkExtent2D m_PendingExtent;
+        bool m_SwapchainOutOfDate = false;
+
+        FramePacer m_FramePacer;
+        // id of the last present, only used when present wait is enabled
+        uint64_t m_PresentId = 0;
+
+        // the image acquired in BeginFrame
+        uint32_t m_ImageIndex = 0;
+        LatencyTracker m_InputLatency;
+        LatencyTracker::Clock::time_point m_LastLatencyReport;
+
+        struct SubmitStatistics
+        {
+            uint64_t Frames = 0;
+            uint64_t Submits = 0;
+            uint64_t MaxSubmits = 0;
+        };
+        // the batcher's submit count at the end of the last frame
+        uint64_t m_LastSubmitCount = 0;
+        SubmitStatistics m_SubmitStatistics;
+        LatencyTracker::Clock::time_point m_LastSubmitReport;
+
+        // recorded on the graphics queue by FlushUploads
+        std::vector<std::function<void(CommandBuffer&)>> m_PendingAcquires;
+        // the stages waiting for each queue's releases
+        std::array<VkPipelineStageFlags, 
+            static_cast<size_t>(QueueType::Count)> m_PendingAcquireStages{};
         std::vector<Framebuffer*> m_Framebuffers;
 
-        VkPipelineLayout m_PipelineLayout;
-        VkPipeline m_Pipeline;
+        PipelineLibrary* m_PipelineLibrary;
+        // owned by the pipeline library
+        GraphicsPipeline* m_GraphicsPipeline;
         uint32_t m_FrameIndex = 0;
+        uint32_t m_FramesInFlight;
 
+        // indexed by frame slot
         std::vector<PerFrameData> m_PerFrameData;
+        // indexed by swapchain image
+        std::vector<PerImageData> m_PerImageData;
 
         // vertex buffer:
         GPUBuffer* m_VertexBuffer;
@@ -121,13 +238,10 @@ namespace LearningVulkan
         // index buffer:
         GPUBuffer* m_IndexBuffer;
         
-        VkDescriptorSetLayout m_CameraDescriptorSetLayout;
         VkDescriptorPool m_DescriptorPool;
-        std::vector<VkDescriptorSet> m_DescriptorSets;
 
         std::vector<Vertex> m_Vertices;
-        std::vector<uint32_t> m_Indices;
-        uint32_t currentIndex = 0;
+        uint32_t m_CubeCount = 0;
 
         Image* m_TestImage;
         Sampler* m_TestImageSampler;
@@ -17,8 +17,8 @@ namespace LearningVulkan
 
     Sampler::~Sampler()
     {
-        LogicalDevice* logicalDevice = RendererContext::GetLogicalDevice();
-        vkDestroySampler(logicalDevice->GetVulkanDevice(), m_Sampler, nullptr);
+        // the sampler can still be used by frames in flight
+        RendererContext::GetDeletionQueue()->PushSampler(m_Sampler);
     }
 
     void Sampler::Create(const SamplerCreateInfo& createInfo)
@@ -36,10 +36,10 @@ namespace LearningVulkan
         PhysicalDevice* physicalDevice = logicalDevice->GetPhysicalDevice();
 
         VkPhysicalDeviceProperties physicalDeviceProperties;
-        vkGetPhysicalDeviceProperties(physicalDevice->GetPhysicalDevice(), &physicalDeviceProperties);
+        RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceProperties(physicalDevice->GetPhysicalDevice(), &physicalDeviceProperties);
         samplerCreateInfo.maxAnisotropy = physicalDeviceProperties.limits.maxSamplerAnisotropy;
 
-        assert(vkCreateSampler(logicalDevice->GetVulkanDevice(), 
+        assert(RendererContext::GetDeviceDispatch().vkCreateSampler(logicalDevice->GetVulkanDevice(), 
             &samplerCreateInfo, nullptr, &m_Sampler) == VK_SUCCESS);
     }
 }
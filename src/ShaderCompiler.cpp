@@ -0,0 +1,296 @@
+#include "ShaderCompiler.h"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // bump when anything about how shaders are compiled changes
+        // so old cache entries aren't picked up
+        constexpr uint64_t CacheVersion = 1;
+
+        constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+        constexpr uint64_t FnvPrime = 1099511628211ull;
+
+        uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= FnvPrime;
+            }
+
+            return hash;
+        }
+
+        uint64_t HashString(uint64_t hash, std::string_view string)
+        {
+            // include the size so that "ab" + "c" and "a" + "bc" differ
+            size_t size = string.size();
+            hash = HashBytes(hash, &size, sizeof(size));
+            return HashBytes(hash, string.data(), string.size());
+        }
+
+        std::string ReadTextFile(const std::filesystem::path& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open())
+                return {};
+
+            std::stringstream stream;
+            stream << file.rdbuf();
+            return stream.str();
+        }
+
+        // the paths in #include "..." directives, relative to the file
+        std::vector<std::filesystem::path> FindIncludes(
+            const std::filesystem::path& sourcePath)
+        {
+            std::vector<std::filesystem::path> includes;
+            std::ifstream file(sourcePath);
+            std::string line;
+            while (std::getline(file, line))
+            {
+                size_t directive = line.find("#include");
+                if (directive == std::string::npos)
+                    continue;
+
+                size_t begin = line.find('"', directive);
+                size_t end = line.find('"', begin + 1);
+                if (begin == std::string::npos || end == std::string::npos)
+                    continue;
+
+                includes.push_back(sourcePath.parent_path() /
+                                   line.substr(begin + 1, end - begin - 1));
+            }
+
+            return includes;
+        }
+
+        shaderc_shader_kind ConvertToShaderKind(ShaderStage stage)
+        {
+            switch (stage)
+            {
+            case ShaderStage::Vertex: return shaderc_vertex_shader;
+            case ShaderStage::Fragment: return shaderc_fragment_shader;
+            case ShaderStage::Compute: return shaderc_compute_shader;
+            }
+
+            assert(false);
+            return shaderc_glsl_infer_from_source;
+        }
+
+        class FileIncluder : public shaderc::CompileOptions::IncluderInterface
+        {
+        private:
+            struct IncludeData
+            {
+                std::string SourceName;
+                std::string Content;
+            };
+
+        public:
+            shaderc_include_result* GetInclude(const char* requestedSource,
+                shaderc_include_type type, const char* requestingSource,
+                size_t includeDepth) override
+            {
+                std::filesystem::path path = 
+                    std::filesystem::path(requestingSource).parent_path() / 
+                    requestedSource;
+
+                IncludeData* data = new IncludeData();
+                data->Content = ReadTextFile(path);
+
+                // an empty source name signals a failed include
+                if (!data->Content.empty())
+                    data->SourceName = path.string();
+                else
+                    data->Content = "couldn't open include " + path.string();
+
+                shaderc_include_result* result = new shaderc_include_result();
+                result->source_name = data->SourceName.c_str();
+                result->source_name_length = data->SourceName.size();
+                result->content = data->Content.c_str();
+                result->content_length = data->Content.size();
+                result->user_data = data;
+                return result;
+            }
+
+            void ReleaseInclude(shaderc_include_result* result) override
+            {
+                delete static_cast<IncludeData*>(result->user_data);
+                delete result;
+            }
+        };
+    }
+
+    ShaderCompiler::ShaderCompiler(
+        const std::filesystem::path& cacheDirectory)
+        : m_CacheDirectory(cacheDirectory)
+    {
+        std::filesystem::create_directories(m_CacheDirectory);
+    }
+
+    std::vector<uint32_t> ShaderCompiler::Compile(
+        const std::filesystem::path& sourcePath, ShaderStage stage,
+        const ShaderCompileOptions& options)
+    {
+        OPTICK_EVENT();
+        OPTICK_TAG("Path", sourcePath.string().c_str());
+
+        std::vector<std::filesystem::path> dependencies =
+                                                GetDependencies(sourcePath);
+        uint64_t hash = ComputeHash(dependencies, stage, options);
+
+        std::vector<uint32_t> code;
+        if (ReadCache(hash, code))
+            return code;
+
+        std::string source = ReadTextFile(sourcePath);
+        if (source.empty())
+        {
+            std::cerr << "Couldn't read shader " << sourcePath << '\n';
+            return {};
+        }
+
+        shaderc::CompileOptions compileOptions;
+        compileOptions.SetTargetEnvironment(shaderc_target_env_vulkan,
+                                            shaderc_env_version_vulkan_1_0);
+        compileOptions.SetIncluder(std::make_unique<FileIncluder>());
+        for (const auto& [name, value] : options.Defines)
+            compileOptions.AddMacroDefinition(name, value);
+
+        if (options.Optimize)
+            compileOptions.SetOptimizationLevel(
+                                    shaderc_optimization_level_performance);
+        else
+            compileOptions.SetGenerateDebugInfo();
+
+        shaderc::SpvCompilationResult result = m_Compiler.CompileGlslToSpv(
+            source, ConvertToShaderKind(stage), sourcePath.string().c_str(),
+            compileOptions);
+
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            std::cerr << "Failed to compile " << sourcePath << ":\n"
+                      << result.GetErrorMessage();
+            return {};
+        }
+
+        code.assign(result.cbegin(), result.cend());
+        WriteCache(hash, code);
+        return code;
+    }
+
+    std::vector<std::filesystem::path> ShaderCompiler::GetDependencies(
+        const std::filesystem::path& sourcePath)
+    {
+        std::vector<std::filesystem::path> dependencies;
+        std::set<std::filesystem::path> visited;
+        std::vector<std::filesystem::path> pending = { sourcePath };
+
+        while (!pending.empty())
+        {
+            std::filesystem::path path = pending.back().lexically_normal();
+            pending.pop_back();
+
+            if (!visited.insert(path).second)
+                continue;
+
+            dependencies.push_back(path);
+
+            std::vector<std::filesystem::path> includes = FindIncludes(path);
+            // reversed so that includes are visited in order
+            pending.insert(pending.end(), includes.rbegin(), includes.rend());
+        }
+
+        return dependencies;
+    }
+
+    uint64_t ShaderCompiler::ComputeHash(
+        const std::vector<std::filesystem::path>& dependencies,
+        ShaderStage stage, const ShaderCompileOptions& options)
+    {
+        uint64_t hash = FnvOffsetBasis;
+        hash = HashBytes(hash, &CacheVersion, sizeof(CacheVersion));
+        hash = HashBytes(hash, &stage, sizeof(stage));
+        hash = HashBytes(hash, &options.Optimize, sizeof(options.Optimize));
+
+        for (const auto& [name, value] : options.Defines)
+        {
+            hash = HashString(hash, name);
+            hash = HashString(hash, value);
+        }
+
+        for (const auto& dependency : dependencies)
+        {
+            hash = HashString(hash, dependency.generic_string());
+            hash = HashString(hash, ReadTextFile(dependency));
+        }
+
+        return hash;
+    }
+
+    bool ShaderCompiler::ReadCache(uint64_t hash, std::vector<uint32_t>& code)
+    {
+        {
+            std::scoped_lock lock(m_CacheMutex);
+            auto it = m_MemoryCache.find(hash);
+            if (it != m_MemoryCache.end())
+            {
+                code = it->second;
+                return true;
+            }
+        }
+
+        std::ifstream file(m_CacheDirectory / (std::to_string(hash) + ".spv"),
+                           std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        size_t fileSize = file.tellg();
+        if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+            return false;
+
+        code.resize(fileSize / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+        std::scoped_lock lock(m_CacheMutex);
+        m_MemoryCache[hash] = code;
+        return true;
+    }
+
+    void ShaderCompiler::WriteCache(uint64_t hash, 
+                                    const std::vector<uint32_t>& code)
+    {
+        {
+            std::scoped_lock lock(m_CacheMutex);
+            m_MemoryCache[hash] = code;
+        }
+
+        // write to a temporary file first so that a different thread or
+        // process never reads a half written entry
+        std::filesystem::path cachePath = 
+                        m_CacheDirectory / (std::to_string(hash) + ".spv");
+        std::filesystem::path temporaryPath = cachePath;
+        temporaryPath += ".tmp";
+
+        {
+            std::ofstream file(temporaryPath, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(code.data()),
+                       code.size() * sizeof(uint32_t));
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, cachePath, error);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <shaderc/shaderc.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace LearningVulkan
+{
+    enum class ShaderStage
+    {
+        Vertex,
+        Fragment,
+        Compute,
+    };
+
+    struct ShaderCompileOptions
+    {
+        std::vector<std::pair<std::string, std::string>> Defines;
+        // debug builds keep debug info in the spirv instead
+#ifdef RELEASE
+        bool Optimize = true;
+#else
+        bool Optimize = false;
+#endif
+    };
+
+    // Compiles glsl to spirv at runtime. Results are cached in memory and
+    // on disk, keyed by a hash of the source, its includes and the compile
+    // options, so unchanged shaders never hit the compiler again.
+    // NOTE: safe to use from multiple threads
+    class ShaderCompiler
+    {
+    public:
+        ShaderCompiler(const std::filesystem::path& cacheDirectory);
+
+        ShaderCompiler(const ShaderCompiler& other) = delete;
+        ShaderCompiler& operator=(const ShaderCompiler& other) = delete;
+
+        // returns an empty vector if the shader failed to compile
+        std::vector<uint32_t> Compile(const std::filesystem::path& sourcePath,
+                                      ShaderStage stage,
+                                      const ShaderCompileOptions& options = {});
+
+        // the source file itself followed by everything it includes
+        static std::vector<std::filesystem::path> GetDependencies(
+            const std::filesystem::path& sourcePath);
+
+    private:
+        static uint64_t ComputeHash(
+            const std::vector<std::filesystem::path>& dependencies,
+            ShaderStage stage, const ShaderCompileOptions& options);
+
+        bool ReadCache(uint64_t hash, std::vector<uint32_t>& code);
+        void WriteCache(uint64_t hash, const std::vector<uint32_t>& code);
+
+    private:
+        shaderc::Compiler m_Compiler;
+        std::filesystem::path m_CacheDirectory;
+
+        std::mutex m_CacheMutex;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> m_MemoryCache;
+    };
+}
@@ -0,0 +1,480 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+#include <unordered_map>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        constexpr uint32_t SpirvMagicNumber = 0x07230203;
+        constexpr uint32_t SpirvHeaderSize = 5;
+
+        // the subset of the spirv spec needed for reflection
+        enum class Op : uint16_t
+        {
+            TypeBool = 20,
+            TypeInt = 21,
+            TypeFloat = 22,
+            TypeVector = 23,
+            TypeMatrix = 24,
+            TypeImage = 25,
+            TypeSampler = 26,
+            TypeSampledImage = 27,
+            TypeArray = 28,
+            TypeRuntimeArray = 29,
+            TypeStruct = 30,
+            TypePointer = 32,
+            Constant = 43,
+            Variable = 59,
+            Decorate = 71,
+            MemberDecorate = 72,
+        };
+
+        enum class Decoration : uint32_t
+        {
+            Block = 2,
+            BufferBlock = 3,
+            ArrayStride = 6,
+            MatrixStride = 7,
+            BuiltIn = 11,
+            Location = 30,
+            Binding = 33,
+            DescriptorSet = 34,
+            Offset = 35,
+        };
+
+        enum class StorageClass : uint32_t
+        {
+            UniformConstant = 0,
+            Input = 1,
+            Uniform = 2,
+            PushConstant = 9,
+            StorageBuffer = 12,
+        };
+
+        enum class ImageDimension : uint32_t
+        {
+            Buffer = 5,
+            SubpassData = 6,
+        };
+
+        struct Type
+        {
+            Op Opcode;
+            // meaning depends on the opcode, see ParseModule
+            std::vector<uint32_t> Operands;
+        };
+
+        struct Member
+        {
+            uint32_t Offset = 0;
+            uint32_t MatrixStride = 0;
+        };
+
+        struct Id
+        {
+            bool HasBinding = false;
+            bool BuiltIn = false;
+            bool Block = false;
+            bool BufferBlock = false;
+            uint32_t Set = 0;
+            uint32_t Binding = 0;
+            uint32_t Location = 0;
+            bool HasLocation = false;
+            uint32_t ArrayStride = 0;
+            std::vector<Member> Members;
+            bool MemberBuiltIn = false;
+        };
+
+        struct Variable
+        {
+            uint32_t Id;
+            uint32_t PointerType;
+            StorageClass Storage;
+        };
+
+        struct Module
+        {
+            std::unordered_map<uint32_t, Id> Ids;
+            std::unordered_map<uint32_t, Type> Types;
+            std::unordered_map<uint32_t, uint32_t> Constants;
+            std::vector<Variable> Variables;
+        };
+
+        Module ParseModule(const std::vector<uint32_t>& code)
+        {
+            assert(code.size() > SpirvHeaderSize);
+            assert(code[0] == SpirvMagicNumber);
+
+            Module module;
+            size_t offset = SpirvHeaderSize;
+            while (offset < code.size())
+            {
+                uint32_t wordCount = code[offset] >> 16;
+                Op opcode = static_cast<Op>(code[offset] & 0xFFFF);
+                assert(wordCount > 0 && offset + wordCount <= code.size());
+                const uint32_t* words = &code[offset + 1];
+
+                switch (opcode)
+                {
+                case Op::Decorate:
+                {
+                    Id& id = module.Ids[words[0]];
+                    switch (static_cast<Decoration>(words[1]))
+                    {
+                    case Decoration::Block: id.Block = true; break;
+                    case Decoration::BufferBlock: id.BufferBlock = true; break;
+                    case Decoration::ArrayStride: 
+                        id.ArrayStride = words[2]; 
+                        break;
+                    case Decoration::BuiltIn: id.BuiltIn = true; break;
+                    case Decoration::Location:
+                        id.Location = words[2];
+                        id.HasLocation = true;
+                        break;
+                    case Decoration::Binding:
+                        id.Binding = words[2];
+                        id.HasBinding = true;
+                        break;
+                    case Decoration::DescriptorSet: id.Set = words[2]; break;
+                    default: break;
+                    }
+                    break;
+                }
+                case Op::MemberDecorate:
+                {
+                    Id& id = module.Ids[words[0]];
+                    uint32_t member = words[1];
+                    if (id.Members.size() <= member)
+                        id.Members.resize(member + 1);
+
+                    switch (static_cast<Decoration>(words[2]))
+                    {
+                    case Decoration::Offset:
+                        id.Members[member].Offset = words[3];
+                        break;
+                    case Decoration::MatrixStride:
+                        id.Members[member].MatrixStride = words[3];
+                        break;
+                    case Decoration::BuiltIn: id.MemberBuiltIn = true; break;
+                    default: break;
+                    }
+                    break;
+                }
+                case Op::TypeBool:
+                case Op::TypeInt:
+                case Op::TypeFloat:
+                case Op::TypeVector:
+                case Op::TypeMatrix:
+                case Op::TypeImage:
+                case Op::TypeSampler:
+                case Op::TypeSampledImage:
+                case Op::TypeArray:
+                case Op::TypeRuntimeArray:
+                case Op::TypeStruct:
+                case Op::TypePointer:
+                    // the result id followed by the type's operands
+                    module.Types[words[0]] = { opcode, 
+                        std::vector<uint32_t>(words + 1, words + wordCount - 1) };
+                    break;
+                case Op::Constant:
+                    // only 32 bit constants are used as array lengths
+                    module.Constants[words[1]] = words[2];
+                    break;
+                case Op::Variable:
+                    module.Variables.push_back({ words[1], words[0],
+                                        static_cast<StorageClass>(words[2]) });
+                    break;
+                default:
+                    break;
+                }
+
+                offset += wordCount;
+            }
+
+            return module;
+        }
+
+        const Type& GetType(const Module& module, uint32_t id)
+        {
+            auto it = module.Types.find(id);
+            assert(it != module.Types.end());
+            return it->second;
+        }
+
+        const Id& GetId(const Module& module, uint32_t id)
+        {
+            static const Id empty;
+            auto it = module.Ids.find(id);
+            return it != module.Ids.end() ? it->second : empty;
+        }
+
+        // the size of a type laid out in a block, matrixStride is the
+        // stride of the member being measured if it's a matrix
+        uint32_t GetTypeSize(const Module& module, uint32_t typeId,
+                             uint32_t matrixStride = 0)
+        {
+            const Type& type = GetType(module, typeId);
+            switch (type.Opcode)
+            {
+            case Op::TypeBool: return 4;
+            case Op::TypeInt:
+            case Op::TypeFloat: return type.Operands[0] / 8;
+            case Op::TypeVector:
+                return GetTypeSize(module, type.Operands[0]) *
+                       type.Operands[1];
+            case Op::TypeMatrix:
+            {
+                uint32_t columnSize = GetTypeSize(module, type.Operands[0]);
+                uint32_t stride = matrixStride != 0 ? matrixStride 
+                                                    : columnSize;
+                return stride * type.Operands[1];
+            }
+            case Op::TypeArray:
+            {
+                uint32_t length = module.Constants.at(type.Operands[1]);
+                uint32_t stride = GetId(module, typeId).ArrayStride;
+                if (stride == 0)
+                    stride = GetTypeSize(module, type.Operands[0], 
+                                         matrixStride);
+                return stride * length;
+            }
+            case Op::TypeStruct:
+            {
+                const Id& structId = GetId(module, typeId);
+                uint32_t size = 0;
+                for (size_t i = 0; i < type.Operands.size(); i++)
+                {
+                    Member member = i < structId.Members.size()
+                                        ? structId.Members[i] : Member{};
+                    size = std::max(size, member.Offset + GetTypeSize(
+                        module, type.Operands[i], member.MatrixStride));
+                }
+
+                return size;
+            }
+            default:
+                // opaque types can't be part of a block
+                assert(false);
+                return 0;
+            }
+        }
+
+        // strips the arrays off a type, returns the element type and
+        // writes the total element count
+        uint32_t GetElementType(const Module& module, uint32_t typeId,
+                                uint32_t& count)
+        {
+            count = 1;
+            const Type* type = &GetType(module, typeId);
+            while (type->Opcode == Op::TypeArray || 
+                   type->Opcode == Op::TypeRuntimeArray)
+            {
+                // unbounded arrays would need descriptor indexing
+                assert(type->Opcode == Op::TypeArray);
+                count *= module.Constants.at(type->Operands[1]);
+                typeId = type->Operands[0];
+                type = &GetType(module, typeId);
+            }
+
+            return typeId;
+        }
+
+        VkDescriptorType GetDescriptorType(const Module& module,
+                                           uint32_t typeId,
+                                           StorageClass storage)
+        {
+            const Type& type = GetType(module, typeId);
+            if (storage == StorageClass::StorageBuffer)
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+            if (storage == StorageClass::Uniform)
+            {
+                return GetId(module, typeId).BufferBlock
+                    ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                    : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+
+            switch (type.Opcode)
+            {
+            case Op::TypeSampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case Op::TypeSampledImage:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case Op::TypeImage:
+            {
+                // operands: sampled type, dim, depth, arrayed, ms, sampled
+                ImageDimension dimension = 
+                                static_cast<ImageDimension>(type.Operands[1]);
+                bool sampled = type.Operands[5] == 1;
+                if (dimension == ImageDimension::Buffer)
+                    return sampled ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+                                   : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+                if (dimension == ImageDimension::SubpassData)
+                    return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+
+                return sampled ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+                               : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            }
+            default:
+                assert(false);
+                return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+            }
+        }
+
+        VkFormat GetVertexFormat(const Module& module, uint32_t typeId,
+                                 uint32_t& size)
+        {
+            const Type* type = &GetType(module, typeId);
+            uint32_t componentCount = 1;
+            if (type->Opcode == Op::TypeVector)
+            {
+                componentCount = type->Operands[1];
+                type = &GetType(module, type->Operands[0]);
+            }
+
+            // only 32 bit components are supported as vertex inputs
+            assert(type->Operands[0] == 32);
+            size = componentCount * 4;
+
+            static constexpr VkFormat FloatFormats[] = {
+                VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+                VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT,
+            };
+            static constexpr VkFormat IntFormats[] = {
+                VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+                VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT,
+            };
+            static constexpr VkFormat UintFormats[] = {
+                VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+                VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT,
+            };
+
+            if (type->Opcode == Op::TypeFloat)
+                return FloatFormats[componentCount - 1];
+
+            assert(type->Opcode == Op::TypeInt);
+            // the second operand of an int type is its signedness
+            return type->Operands[1] ? IntFormats[componentCount - 1]
+                                     : UintFormats[componentCount - 1];
+        }
+    }
+
+    ShaderReflection ShaderReflection::Reflect(
+        const std::vector<uint32_t>& code, VkShaderStageFlagBits stage)
+    {
+        Module module = ParseModule(code);
+        ShaderReflection reflection;
+
+        for (const Variable& variable : module.Variables)
+        {
+            const Id& id = GetId(module, variable.Id);
+            // operands of a pointer: storage class, pointee type
+            uint32_t typeId = GetType(module, variable.PointerType).Operands[1];
+
+            switch (variable.Storage)
+            {
+            case StorageClass::UniformConstant:
+            case StorageClass::Uniform:
+            case StorageClass::StorageBuffer:
+            {
+                if (!id.HasBinding)
+                    break;
+
+                DescriptorBinding binding{};
+                binding.Set = id.Set;
+                binding.Binding = id.Binding;
+                typeId = GetElementType(module, typeId, binding.Count);
+                binding.Type = GetDescriptorType(module, typeId,
+                                                 variable.Storage);
+                binding.Stages = stage;
+                reflection.DescriptorBindings.push_back(binding);
+                break;
+            }
+            case StorageClass::PushConstant:
+                reflection.PushConstantSize = GetTypeSize(module, typeId);
+                reflection.PushConstantStages = stage;
+                break;
+            case StorageClass::Input:
+            {
+                if (stage != VK_SHADER_STAGE_VERTEX_BIT || id.BuiltIn || 
+                    !id.HasLocation || GetId(module, typeId).MemberBuiltIn)
+                    break;
+
+                VertexInputAttribute attribute{};
+                attribute.Location = id.Location;
+                attribute.Format = GetVertexFormat(module, typeId,
+                                                   attribute.Size);
+                reflection.VertexInputs.push_back(attribute);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        std::sort(reflection.DescriptorBindings.begin(),
+                  reflection.DescriptorBindings.end());
+        std::sort(reflection.VertexInputs.begin(),
+                  reflection.VertexInputs.end(),
+                  [](const VertexInputAttribute& a, 
+                     const VertexInputAttribute& b)
+                  { return a.Location < b.Location; });
+
+        return reflection;
+    }
+
+    void ShaderReflection::Merge(const ShaderReflection& other)
+    {
+        for (const DescriptorBinding& otherBinding : other.DescriptorBindings)
+        {
+            auto it = std::find_if(DescriptorBindings.begin(),
+                                   DescriptorBindings.end(),
+                [&otherBinding](const DescriptorBinding& binding)
+                {
+                    return binding.Set == otherBinding.Set &&
+                           binding.Binding == otherBinding.Binding;
+                });
+
+            if (it == DescriptorBindings.end())
+            {
+                DescriptorBindings.push_back(otherBinding);
+                continue;
+            }
+
+            // both stages have to agree on what is bound
+            assert(it->Type == otherBinding.Type && 
+                   it->Count == otherBinding.Count);
+            it->Stages |= otherBinding.Stages;
+        }
+
+        std::sort(DescriptorBindings.begin(), DescriptorBindings.end());
+
+        // all stages share a single push constant range
+        PushConstantSize = std::max(PushConstantSize, other.PushConstantSize);
+        PushConstantStages |= other.PushConstantStages;
+
+        VertexInputs.insert(VertexInputs.end(), other.VertexInputs.begin(),
+                            other.VertexInputs.end());
+    }
+
+    uint32_t ShaderReflection::GetSetCount() const
+    {
+        // the bindings are sorted so the last one has the highest set
+        return DescriptorBindings.empty() ? 0 
+                                          : DescriptorBindings.back().Set + 1;
+    }
+
+    std::vector<DescriptorBinding> ShaderReflection::GetSetBindings(
+        uint32_t set) const
+    {
+        std::vector<DescriptorBinding> bindings;
+        std::copy_if(DescriptorBindings.begin(), DescriptorBindings.end(),
+                     std::back_inserter(bindings),
+                     [set](const DescriptorBinding& binding)
+                     { return binding.Set == set; });
+        return bindings;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <compare>
+#include <cstdint>
+#include <vector>
+
+namespace LearningVulkan
+{
+    struct DescriptorBinding
+    {
+        uint32_t Set;
+        uint32_t Binding;
+        VkDescriptorType Type;
+        uint32_t Count;
+        VkShaderStageFlags Stages;
+
+        auto operator<=>(const DescriptorBinding& other) const = default;
+    };
+
+    struct VertexInputAttribute
+    {
+        uint32_t Location;
+        VkFormat Format;
+        uint32_t Size;
+    };
+
+    // The resources a shader uses, read straight from its spirv
+    struct ShaderReflection
+    {
+        // sorted by set and binding
+        std::vector<DescriptorBinding> DescriptorBindings;
+        // 0 if the shader has no push constants
+        uint32_t PushConstantSize = 0;
+        VkShaderStageFlags PushConstantStages = 0;
+        // sorted by location, only filled for vertex shaders
+        std::vector<VertexInputAttribute> VertexInputs;
+
+        static ShaderReflection Reflect(const std::vector<uint32_t>& code,
+                                        VkShaderStageFlagBits stage);
+
+        // combines the resources of another stage of the same pipeline
+        void Merge(const ShaderReflection& other);
+
+        uint32_t GetSetCount() const;
+        std::vector<DescriptorBinding> GetSetBindings(uint32_t set) const;
+    };
+}
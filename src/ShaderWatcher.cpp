@@ -0,0 +1,110 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    ShaderWatcher::ShaderWatcher(ShaderCompiler* compiler,
+                                 std::chrono::milliseconds pollInterval)
+        : m_Compiler(compiler), m_PollInterval(pollInterval)
+    {
+        m_Thread = std::jthread([this](std::stop_token stopToken)
+        {
+            OPTICK_THREAD("ShaderWatcher");
+            while (!stopToken.stop_requested())
+            {
+                Poll();
+                std::this_thread::sleep_for(m_PollInterval);
+            }
+        });
+    }
+
+    void ShaderWatcher::Watch(const std::filesystem::path& sourcePath,
+                              ShaderStage stage,
+                              const ShaderCompileOptions& options)
+    {
+        WatchedShader shader;
+        shader.Stage = stage;
+        shader.Options = options;
+        // record the current write times so the first poll doesn't
+        // recompile everything
+        HasChanged(shader, sourcePath);
+
+        std::scoped_lock lock(m_Mutex);
+        m_Shaders[sourcePath.lexically_normal()] = std::move(shader);
+    }
+
+    std::vector<std::filesystem::path> ShaderWatcher::GetRecompiledShaders()
+    {
+        std::scoped_lock lock(m_Mutex);
+        return std::exchange(m_RecompiledShaders, {});
+    }
+
+    void ShaderWatcher::Poll()
+    {
+        // work on a copy so compiling doesn't block Watch and
+        // GetRecompiledShaders
+        std::map<std::filesystem::path, WatchedShader> shaders;
+        {
+            std::scoped_lock lock(m_Mutex);
+            shaders = m_Shaders;
+        }
+
+        std::vector<std::filesystem::path> recompiledShaders;
+        for (auto& [sourcePath, shader] : shaders)
+        {
+            if (!HasChanged(shader, sourcePath))
+                continue;
+
+            std::cout << "Recompiling " << sourcePath << '\n';
+            if (!m_Compiler->Compile(sourcePath, shader.Stage,
+                                     shader.Options).empty())
+                recompiledShaders.push_back(sourcePath);
+        }
+
+        std::scoped_lock lock(m_Mutex);
+        for (auto& [sourcePath, shader] : shaders)
+        {
+            auto it = m_Shaders.find(sourcePath);
+            if (it != m_Shaders.end())
+                it->second.WriteTimes = std::move(shader.WriteTimes);
+        }
+
+        for (const auto& sourcePath : recompiledShaders)
+        {
+            if (std::find(m_RecompiledShaders.begin(), 
+                          m_RecompiledShaders.end(),
+                          sourcePath) == m_RecompiledShaders.end())
+                m_RecompiledShaders.push_back(sourcePath);
+        }
+    }
+
+    bool ShaderWatcher::HasChanged(WatchedShader& shader,
+                                   const std::filesystem::path& sourcePath)
+    {
+        std::map<std::filesystem::path,
+                           std::filesystem::file_time_type> writeTimes;
+
+        for (const auto& dependency : 
+             ShaderCompiler::GetDependencies(sourcePath))
+        {
+            std::error_code error;
+            std::filesystem::file_time_type writeTime =
+                std::filesystem::last_write_time(dependency, error);
+
+            // editors sometimes delete and recreate files on save, 
+            // just try again on the next poll
+            if (error)
+                return false;
+
+            writeTimes[dependency] = writeTime;
+        }
+
+        bool changed = writeTimes != shader.WriteTimes;
+        shader.WriteTimes = std::move(writeTimes);
+        return changed;
+    }
+}
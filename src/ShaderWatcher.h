@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ShaderCompiler.h"
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <map>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Polls the watched shaders and everything they include for changes
+    // on a background thread. Changed shaders are recompiled right away so
+    // that rebuilding the pipelines that use them only hits the cache
+    class ShaderWatcher
+    {
+    public:
+        ShaderWatcher(ShaderCompiler* compiler,
+                      std::chrono::milliseconds pollInterval =
+                                            std::chrono::milliseconds(250));
+
+        ShaderWatcher(const ShaderWatcher& other) = delete;
+        ShaderWatcher& operator=(const ShaderWatcher& other) = delete;
+
+        void Watch(const std::filesystem::path& sourcePath, ShaderStage stage,
+                   const ShaderCompileOptions& options = {});
+
+        // the shaders that changed since the last call, each one compiled
+        // successfully so the pipelines using them can be rebuilt
+        std::vector<std::filesystem::path> GetRecompiledShaders();
+
+    private:
+        struct WatchedShader
+        {
+            ShaderStage Stage;
+            ShaderCompileOptions Options;
+            std::map<std::filesystem::path, 
+                               std::filesystem::file_time_type> WriteTimes;
+        };
+
+        void Poll();
+        static bool HasChanged(WatchedShader& shader,
+                               const std::filesystem::path& sourcePath);
+
+    private:
+        ShaderCompiler* m_Compiler;
+        std::chrono::milliseconds m_PollInterval;
+
+        std::mutex m_Mutex;
+        std::map<std::filesystem::path, WatchedShader> m_Shaders;
+        std::vector<std::filesystem::path> m_RecompiledShaders;
+
+        // declared last so it's stopped and joined before the members it
+        // uses are destroyed
+        std::jthread m_Thread;
+    };
+}
@@ -0,0 +1,190 @@
+#include "SubmitBatcher.h"
+
+#include <cassert>
+
+#include <optick.h>
+
+namespace LearningVulkan
+{
+    namespace
+    {
+        // the arrays one VkSubmitInfo points into
+        struct SubmitInfoData
+        {
+            std::vector<VkCommandBuffer> CommandBuffers;
+            std::vector<VkSemaphore> WaitSemaphores;
+            std::vector<VkPipelineStageFlags> WaitStages;
+            std::vector<uint64_t> WaitValues;
+            std::vector<VkSemaphore> SignalSemaphores;
+            std::vector<uint64_t> SignalValues;
+        };
+    }
+
+    SubmitBatcher::SubmitBatcher(LogicalDevice* logicalDevice)
+        : m_LogicalDevice(logicalDevice)
+    {
+    }
+
+    uint64_t SubmitBatcher::Enqueue(QueueType queue,
+                                    const QueueSubmission& submission)
+    {
+        std::scoped_lock lock(m_Mutex);
+
+        Batch& batch = GetBatch(queue);
+
+        // waiting on a batch that isn't submitted yet could make two
+        // batches wait on each other, and a binary semaphore has to be
+        // signaled by a submit made before the wait, so batches only ever
+        // wait on work that already reached its queue
+        for (const SemaphoreWait& wait : submission.Waits)
+        {
+            // the batch would wait on its own signal
+            assert(wait.Semaphore != 
+                       m_LogicalDevice->GetTimeline(queue).GetSemaphore() ||
+                   batch.Submissions.empty() ||
+                   wait.Value < batch.TimelineValue);
+
+            for (size_t i = 0; i < m_Batches.size(); i++)
+            {
+                QueueType other = static_cast<QueueType>(i);
+                const Batch& otherBatch = m_Batches.at(i);
+                if (other == queue || otherBatch.Submissions.empty())
+                    continue;
+
+                if (wait.Semaphore ==
+                        m_LogicalDevice->GetTimeline(other).GetSemaphore() ||
+                    Signals(otherBatch, wait.Semaphore))
+                    FlushLocked(other);
+            }
+        }
+
+        if (batch.Submissions.empty())
+            batch.TimelineValue = m_LogicalDevice->GetTimeline(queue).Advance();
+
+        if (submission.Fence != VK_NULL_HANDLE)
+        {
+            // one fence per vkQueueSubmit
+            assert(batch.Fence == VK_NULL_HANDLE);
+            batch.Fence = submission.Fence;
+        }
+
+        batch.Submissions.push_back(submission);
+        return batch.TimelineValue;
+    }
+
+    uint64_t SubmitBatcher::Flush(QueueType queue)
+    {
+        std::scoped_lock lock(m_Mutex);
+        FlushLocked(queue);
+        return m_LogicalDevice->GetTimeline(queue).GetLastReserved();
+    }
+
+    void SubmitBatcher::FlushAll()
+    {
+        std::scoped_lock lock(m_Mutex);
+        for (size_t i = 0; i < m_Batches.size(); i++)
+            FlushLocked(static_cast<QueueType>(i));
+    }
+
+    SubmitBatcher::Batch& SubmitBatcher::GetBatch(QueueType queue)
+    {
+        return m_Batches.at(static_cast<size_t>(queue));
+    }
+
+    bool SubmitBatcher::Signals(const Batch& batch, VkSemaphore semaphore)
+    {
+        for (const QueueSubmission& submission : batch.Submissions)
+            for (const SemaphoreSignal& signal : submission.Signals)
+                if (signal.Semaphore == semaphore)
+                    return true;
+
+        return false;
+    }
+
+    void SubmitBatcher::FlushLocked(QueueType queue)
+    {
+        Batch& batch = GetBatch(queue);
+        if (batch.Submissions.empty())
+            return;
+
+        OPTICK_EVENT();
+        OPTICK_TAG("Submissions", batch.Submissions.size());
+
+        // the waits of a submission have to come before its command
+        // buffers and its signals after them, so it only joins the
+        // previous submit info if that doesn't move either
+        std::vector<SubmitInfoData> infoData;
+        for (const QueueSubmission& submission : batch.Submissions)
+        {
+            if (infoData.empty() ||
+                !infoData.back().SignalSemaphores.empty() ||
+                (!submission.Waits.empty() &&
+                 !infoData.back().CommandBuffers.empty()))
+                infoData.emplace_back();
+
+            SubmitInfoData& data = infoData.back();
+            for (const CommandBuffer* commandBuffer : submission.CommandBuffers)
+                data.CommandBuffers.push_back(
+                    commandBuffer->GetVulkanCommandBuffer());
+
+            for (const SemaphoreWait& wait : submission.Waits)
+            {
+                data.WaitSemaphores.push_back(wait.Semaphore);
+                data.WaitStages.push_back(wait.Stages);
+                data.WaitValues.push_back(wait.Value);
+            }
+
+            for (const SemaphoreSignal& signal : submission.Signals)
+            {
+                data.SignalSemaphores.push_back(signal.Semaphore);
+                data.SignalValues.push_back(signal.Value);
+            }
+        }
+
+        // signaled after everything in the batch
+        QueueTimeline& timeline = m_LogicalDevice->GetTimeline(queue);
+        infoData.back().SignalSemaphores.push_back(timeline.GetSemaphore());
+        infoData.back().SignalValues.push_back(batch.TimelineValue);
+
+        std::vector<VkSubmitInfo> submitInfos(infoData.size());
+        std::vector<VkTimelineSemaphoreSubmitInfo> timelineSubmitInfos(
+                                                            infoData.size());
+        for (size_t i = 0; i < infoData.size(); i++)
+        {
+            const SubmitInfoData& data = infoData.at(i);
+
+            // the values of binary semaphores in the same submit are
+            // ignored
+            VkTimelineSemaphoreSubmitInfo& timelineSubmitInfo =
+                                                    timelineSubmitInfos.at(i);
+            timelineSubmitInfo.sType =
+                VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineSubmitInfo.waitSemaphoreValueCount =
+                data.WaitValues.size();
+            timelineSubmitInfo.pWaitSemaphoreValues = data.WaitValues.data();
+            timelineSubmitInfo.signalSemaphoreValueCount =
+                data.SignalValues.size();
+            timelineSubmitInfo.pSignalSemaphoreValues =
+                data.SignalValues.data();
+
+            VkSubmitInfo& submitInfo = submitInfos.at(i);
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.pNext = &timelineSubmitInfo;
+            submitInfo.commandBufferCount = data.CommandBuffers.size();
+            submitInfo.pCommandBuffers = data.CommandBuffers.data();
+            submitInfo.waitSemaphoreCount = data.WaitSemaphores.size();
+            submitInfo.pWaitSemaphores = data.WaitSemaphores.data();
+            submitInfo.pWaitDstStageMask = data.WaitStages.data();
+            submitInfo.signalSemaphoreCount = data.SignalSemaphores.size();
+            submitInfo.pSignalSemaphores = data.SignalSemaphores.data();
+        }
+
+        m_LogicalDevice->QueueSubmit(m_LogicalDevice->GetQueue(queue),
+                                     submitInfos.size(), submitInfos.data(),
+                                     batch.Fence);
+        m_SubmitCount++;
+
+        batch.Submissions.clear();
+        batch.Fence = VK_NULL_HANDLE;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "LogicalDevice.h"
+#include "QueueOwnership.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace LearningVulkan
+{
+    // Collects the submissions for each queue and hands them to the queue
+    // in a single vkQueueSubmit when flushed. Submissions without waits
+    // share a submit info with the ones before them, and the whole batch
+    // signals the queue's timeline once
+    class SubmitBatcher
+    {
+    public:
+        SubmitBatcher(LogicalDevice* logicalDevice);
+
+        SubmitBatcher(const SubmitBatcher& other) = delete;
+        SubmitBatcher& operator=(const SubmitBatcher& other) = delete;
+
+        // returns the timeline value the queue reaches once the batch the
+        // submission ended up in is done, the value can only be waited on
+        // by the host after the queue was flushed. Batches of other queues
+        // that signal a semaphore the submission waits on are flushed
+        // right away
+        uint64_t Enqueue(QueueType queue, const QueueSubmission& submission);
+        // returns the batch's timeline value, or the last submitted one if
+        // nothing was batched
+        uint64_t Flush(QueueType queue);
+        // nothing is left waiting in a batch, e.g. before waiting for the
+        // device to go idle
+        void FlushAll();
+
+        // vkQueueSubmit calls made so far
+        uint64_t GetSubmitCount() const { return m_SubmitCount; }
+
+    private:
+        struct Batch
+        {
+            std::vector<QueueSubmission> Submissions;
+            uint64_t TimelineValue = 0;
+            VkFence Fence = VK_NULL_HANDLE;
+        };
+
+        void FlushLocked(QueueType queue);
+        Batch& GetBatch(QueueType queue);
+        // whether a submission in the batch signals the semaphore, the
+        // queue's timeline isn't part of the submissions
+        static bool Signals(const Batch& batch, VkSemaphore semaphore);
+
+    private:
+        LogicalDevice* m_LogicalDevice;
+        std::array<Batch, static_cast<size_t>(QueueType::Count)> m_Batches;
+        // the timeline values have to reach the queues in order
+        std::mutex m_Mutex;
+        std::atomic<uint64_t> m_SubmitCount = 0;
+    };
+}
@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <cassert>
 
+#include <optick.h>
+
 namespace LearningVulkan 
 {
 	static constexpr VkPresentModeKHR ConvertToVkPresentMode(PresentMode presentMode) 
@@ -21,6 +23,18 @@ namespace LearningVulkan
 		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
+	static constexpr const char* GetPresentModeName(VkPresentModeKHR presentMode)
+	{
+		switch (presentMode)
+		{
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR: return "Fifo";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "Fifo Relaxed";
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+		default: return "Unknown";
+		}
+	}
+
 	Swapchain::Swapchain(LogicalDevice* logicalDevice, uint32_t width, uint32_t height, PresentMode presentMode)
 		: m_Width(width), m_Height(height), m_DesiredPresentMode(presentMode), m_LogicalDevice(logicalDevice)
 	{
@@ -64,8 +78,14 @@ namespace LearningVulkan
 		Create();
 	}
 
-	void Swapchain::Present(VkSemaphore semaphore, uint32_t imageIndex)
+	void Swapchain::SetPresentMode(PresentMode presentMode)
 	{
+		m_DesiredPresentMode = presentMode;
+	}
+
+	VkResult Swapchain::Present(VkSemaphore semaphore, uint32_t imageIndex, uint64_t presentId)
+	{
+		OPTICK_EVENT();
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
@@ -74,19 +94,40 @@ namespace LearningVulkan
 		presentInfo.pSwapchains = &m_Swapchain;
 		presentInfo.pImageIndices = &imageIndex;
 
-		vkQueuePresentKHR(m_LogicalDevice->GetPresentQueue(), &presentInfo);
+		VkPresentIdKHR presentIdInfo{};
+		if (presentId != 0)
+		{
+			assert(m_LogicalDevice->IsPresentWaitEnabled());
+			presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			presentIdInfo.swapchainCount = 1;
+			presentIdInfo.pPresentIds = &presentId;
+			presentInfo.pNext = &presentIdInfo;
+		}
+
+		VkResult result = m_LogicalDevice->GetDispatch().vkQueuePresentKHR(m_LogicalDevice->GetPresentQueue(), &presentInfo);
+
+		// resolves the gpu zones of the frames that finished
+		OPTICK_GPU_FLIP(m_Swapchain);
+		return result;
+	}
+
+	VkResult Swapchain::WaitForPresent(uint64_t presentId, uint64_t timeout)
+	{
+		return m_LogicalDevice->WaitForPresent(m_Swapchain, presentId, timeout);
 	}
 
-	void Swapchain::AcquireNextImage(VkSemaphore imageAcquireSemaphore, uint32_t& imageIndex)
+	VkResult Swapchain::AcquireNextImage(VkSemaphore imageAcquireSemaphore, uint32_t& imageIndex)
 	{
-		vkAcquireNextImageKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, UINT64_MAX, 
+		OPTICK_EVENT();
+		return m_LogicalDevice->GetDispatch().vkAcquireNextImageKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, UINT64_MAX, 
 							imageAcquireSemaphore, VK_NULL_HANDLE, &imageIndex);
 	}
 
 	void Swapchain::Create()
 	{
+		OPTICK_EVENT();
 		const SwapchainSupportDetails& swapchainDetails = m_LogicalDevice->GetPhysicalDevice()->QuerySwapChainSupport();
-		VkPresentModeKHR presentMode = ChooseSurfacePresentMode(swapchainDetails.PresentModes);
+		m_PresentMode = ChooseSurfacePresentMode(swapchainDetails.PresentModes);
 		m_Extent = ChooseSwapchainExtent(swapchainDetails.SurfaceCapabilities);
 		m_SurfaceFormat = ChooseCorrectSurfaceFormat(swapchainDetails.SurfaceFormats);
 
@@ -101,7 +142,7 @@ namespace LearningVulkan
 		swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 		swapchainCreateInfo.imageExtent = m_Extent;
 		swapchainCreateInfo.surface = RendererContext::GetVulkanSurface();
-		swapchainCreateInfo.presentMode = ConvertToVkPresentMode(m_DesiredPresentMode);
+		swapchainCreateInfo.presentMode = m_PresentMode;
 		swapchainCreateInfo.imageFormat = m_SurfaceFormat.format;
 		swapchainCreateInfo.imageColorSpace = m_SurfaceFormat.colorSpace;
 		swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
@@ -130,15 +171,15 @@ namespace LearningVulkan
 		swapchainCreateInfo.clipped = VK_TRUE;
 		swapchainCreateInfo.oldSwapchain = oldSwapchain;
 
-		assert(vkCreateSwapchainKHR(m_LogicalDevice->GetVulkanDevice(), &swapchainCreateInfo, nullptr, &m_Swapchain) == VK_SUCCESS);
+		assert(m_LogicalDevice->GetDispatch().vkCreateSwapchainKHR(m_LogicalDevice->GetVulkanDevice(), &swapchainCreateInfo, nullptr, &m_Swapchain) == VK_SUCCESS);
 
 		if (oldSwapchain != VK_NULL_HANDLE)
 			Destroy(oldSwapchain);
 
 		uint32_t imageCount;
-		vkGetSwapchainImagesKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, &imageCount, nullptr);
+		m_LogicalDevice->GetDispatch().vkGetSwapchainImagesKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, &imageCount, nullptr);
 		m_Images.resize(imageCount);
-		vkGetSwapchainImagesKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, &imageCount, m_Images.data());
+		m_LogicalDevice->GetDispatch().vkGetSwapchainImagesKHR(m_LogicalDevice->GetVulkanDevice(), m_Swapchain, &imageCount, m_Images.data());
 
 		m_ImageViews.resize(imageCount);
 
@@ -158,7 +199,7 @@ namespace LearningVulkan
 			imageViewCreateInfo.subresourceRange.levelCount = 1;
 			imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 			imageViewCreateInfo.subresourceRange.layerCount = 1;
-			assert(vkCreateImageView(m_LogicalDevice->GetVulkanDevice(), &imageViewCreateInfo, nullptr, &m_ImageViews.at(i)) == VK_SUCCESS);
+			assert(m_LogicalDevice->GetDispatch().vkCreateImageView(m_LogicalDevice->GetVulkanDevice(), &imageViewCreateInfo, nullptr, &m_ImageViews.at(i)) == VK_SUCCESS);
 		}
 
         CreateDepthResources();
@@ -166,12 +207,16 @@ namespace LearningVulkan
 
 	void Swapchain::Destroy(VkSwapchainKHR swapchain)
 	{
-		for (const auto& imageViews : m_ImageViews)
-			vkDestroyImageView(m_LogicalDevice->GetVulkanDevice(), imageViews, nullptr);
+		// frames in flight can still be rendering to or presenting the
+		// images, so they get destroyed once those frames are done
+		DeletionQueue* deletionQueue = RendererContext::GetDeletionQueue();
+		for (const auto& imageView : m_ImageViews)
+			deletionQueue->PushImageView(imageView);
 
-		vkDestroySwapchainKHR(m_LogicalDevice->GetVulkanDevice(), swapchain, nullptr);
+		deletionQueue->PushSwapchain(swapchain);
 
         delete m_DepthImage;
+        m_DepthImage = nullptr;
 	}
 
     void Swapchain::CreateDepthResources()
@@ -187,7 +232,7 @@ namespace LearningVulkan
         for (auto desiredDepthFormat : desiredDepthFormats)
         {
             VkFormatProperties format_properties;
-            vkGetPhysicalDeviceFormatProperties(physicalDevice->GetPhysicalDevice(), desiredDepthFormat, &format_properties);
+            RendererContext::GetInstanceDispatch().vkGetPhysicalDeviceFormatProperties(physicalDevice->GetPhysicalDevice(), desiredDepthFormat, &format_properties);
 
             if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) == VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
             {
@@ -212,6 +257,7 @@ namespace LearningVulkan
         depthImageCreateInfo.Format = depthFormat;
         depthImageCreateInfo.MemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
         depthImageCreateInfo.AspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
+        depthImageCreateInfo.Category = MemoryCategory::Attachment;
 
         m_DepthImage = new Image(depthImageCreateInfo);
     }
@@ -227,17 +273,44 @@ namespace LearningVulkan
 		return surfaceFormats.at(0);
 	}
 
-	constexpr VkPresentModeKHR Swapchain::ChooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& presentModes) 
+	VkPresentModeKHR Swapchain::ChooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& presentModes) 
 	{
-		for (const auto& presentMode : presentModes)
+		// the modes to try in order, mailbox and immediate both don't block
+		// on the display so they fall back to each other before going to fifo
+		std::vector<VkPresentModeKHR> fallbackChain;
+		switch (m_DesiredPresentMode)
 		{
-			// present images last in first out
-			if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-				return presentMode;
+		case PresentMode::Mailbox:
+			fallbackChain = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+			break;
+		case PresentMode::Immediate:
+			fallbackChain = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
+		case PresentMode::Fifo:
+			break;
 		}
 
-		// present images first in first out
-		return VK_PRESENT_MODE_FIFO_KHR;
+		VkPresentModeKHR desiredPresentMode = ConvertToVkPresentMode(m_DesiredPresentMode);
+		VkPresentModeKHR chosenPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+		for (VkPresentModeKHR candidate : fallbackChain)
+		{
+			if (std::find(presentModes.begin(), presentModes.end(), candidate) != presentModes.end())
+			{
+				chosenPresentMode = candidate;
+				break;
+			}
+		}
+
+		// fifo is the only mode that's required to be supported, only
+		// reported when the choice changes and not on every resize
+		bool choiceChanged = chosenPresentMode != m_PresentMode ||
+			desiredPresentMode != m_ReportedDesiredPresentMode;
+		if (chosenPresentMode != desiredPresentMode && choiceChanged)
+			std::cout << "Present mode " << GetPresentModeName(desiredPresentMode)
+				<< " is not supported, falling back to " << GetPresentModeName(chosenPresentMode) << '\n';
+		m_ReportedDesiredPresentMode = desiredPresentMode;
+
+		return chosenPresentMode;
 	}
 
 	constexpr VkExtent2D Swapchain::ChooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities) 
@@ -26,15 +26,21 @@ namespace LearningVulkan
         const VkSurfaceFormatKHR& GetSurfaceFormat() const;
         constexpr const VkSwapchainKHR& GetVulkanSwapchain() const;
         void Resize(uint32_t width, uint32_t height);
-        void Present(VkSemaphore semaphore, uint32_t imageIndex);
-        void AcquireNextImage(VkSemaphore imageAcquireSemaphore, uint32_t& imageIndex);
+        // takes effect the next time the swapchain is recreated
+        void SetPresentMode(PresentMode presentMode);
+        VkPresentModeKHR GetPresentMode() const { return m_PresentMode; }
+        // a non zero present id can later be waited on with WaitForPresent,
+        // only valid when VK_KHR_present_wait is enabled
+        VkResult Present(VkSemaphore semaphore, uint32_t imageIndex, uint64_t presentId = 0);
+        VkResult WaitForPresent(uint64_t presentId, uint64_t timeout);
+        VkResult AcquireNextImage(VkSemaphore imageAcquireSemaphore, uint32_t& imageIndex);
         constexpr Image* GetDepthImage() const;
         
     private:
         void Create();
         void Destroy(VkSwapchainKHR swapchain);
         constexpr const VkSurfaceFormatKHR& ChooseCorrectSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& surfaceFormats);
-        constexpr VkPresentModeKHR ChooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& presentModes);
+        VkPresentModeKHR ChooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& presentModes);
         constexpr VkExtent2D ChooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities);
         void CreateDepthResources();
 
@@ -42,11 +48,14 @@ namespace LearningVulkan
         VkSwapchainKHR m_Swapchain = VK_NULL_HANDLE;
         uint32_t m_Width, m_Height;
         PresentMode m_DesiredPresentMode;
+        VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+        // the desired mode of the last creation, for the fallback message
+        VkPresentModeKHR m_ReportedDesiredPresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
         LogicalDevice* m_LogicalDevice;
         VkSurfaceFormatKHR m_SurfaceFormat;
         std::vector<VkImage> m_Images;
         std::vector<VkImageView> m_ImageViews;
-        Image* m_DepthImage;
+        Image* m_DepthImage = nullptr;
         VkExtent2D m_Extent;
     };
 }
@@ -1,35 +1,28 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
+
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace LearningVulkan
 {
+    // the pipeline's vertex input is reflected from the shader, which
+    // expects the attributes tightly packed in location order
     struct Vertex
     {
         glm::vec3 Position;
         glm::vec3 Color;
         glm::vec2 TextureCoordinates;
+    };
 
-        static VkVertexInputBindingDescription GetBindingDescription()
-        {
-            return {
-                .binding = 0,
-                .stride = sizeof(Vertex),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-            };
-        }
-
-        static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions()
-        {
-            std::array attributeDescriptions = {
-                VkVertexInputAttributeDescription { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, Position) },
-                VkVertexInputAttributeDescription { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, Color) },
-                VkVertexInputAttributeDescription {.location = 2, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(Vertex, TextureCoordinates) },
-            };
-
-            return attributeDescriptions;
-        }
+    // indexed by shader location, the reflected vertex input is checked
+    // against these so a shader change can't read the wrong bytes
+    inline constexpr std::array<uint32_t, 3> VertexAttributeOffsets = {
+        offsetof(Vertex, Position),
+        offsetof(Vertex, Color),
+        offsetof(Vertex, TextureCoordinates),
     };
 
     struct CameraData
@@ -38,6 +31,19 @@ namespace LearningVulkan
         glm::mat4 View;
     };
 
+    // per draw data passed through push constants, 
+    // has to match the push constant block in BasicFrag.glsl
+    struct DrawData
+    {
+        glm::vec4 Tint;
+    };
+
+    // has to match the push constant block in CubeIndicesComp.glsl
+    struct IndexGenerationData
+    {
+        uint32_t FaceCount;
+    };
+
     struct LightData
     {
         glm::vec3 LightColor;
@@ -0,0 +1,48 @@
+#include "VulkanFunctions.h"
+
+#include <cassert>
+
+namespace LearningVulkan
+{
+    void InstanceDispatch::Load(VkInstance instance)
+    {
+#define LV_LOAD_FUNCTION(name)                                          \
+        name = reinterpret_cast<PFN_##name>(                            \
+            vkGetInstanceProcAddr(instance, #name));
+
+        LV_INSTANCE_FUNCTIONS(LV_LOAD_FUNCTION)
+        LV_INSTANCE_EXTENSION_FUNCTIONS(LV_LOAD_FUNCTION)
+#undef LV_LOAD_FUNCTION
+
+#define LV_CHECK_FUNCTION(name) assert(name);
+        LV_INSTANCE_FUNCTIONS(LV_CHECK_FUNCTION)
+#undef LV_CHECK_FUNCTION
+    }
+
+    void DeviceDispatch::Load(VkDevice device,
+        const InstanceDispatch& instance, uint32_t apiVersion)
+    {
+        PFN_vkGetDeviceProcAddr getDeviceProcAddr =
+                                                instance.vkGetDeviceProcAddr;
+
+#define LV_LOAD_FUNCTION(name)                                          \
+        name = reinterpret_cast<PFN_##name>(                            \
+            getDeviceProcAddr(device, #name));
+
+        LV_DEVICE_FUNCTIONS(LV_LOAD_FUNCTION)
+        LV_DEVICE_EXTENSION_FUNCTIONS(LV_LOAD_FUNCTION)
+#undef LV_LOAD_FUNCTION
+
+#define LV_LOAD_PROMOTED_FUNCTION(name, extensionName, promotedVersion) \
+        name = reinterpret_cast<PFN_##name>(                            \
+            getDeviceProcAddr(device, apiVersion >= promotedVersion     \
+                                      ? #name : #extensionName));
+
+        LV_DEVICE_PROMOTED_FUNCTIONS(LV_LOAD_PROMOTED_FUNCTION)
+#undef LV_LOAD_PROMOTED_FUNCTION
+
+#define LV_CHECK_FUNCTION(name, ...) assert(name);
+        LV_DEVICE_FUNCTIONS(LV_CHECK_FUNCTION)
+#undef LV_CHECK_FUNCTION
+    }
+}
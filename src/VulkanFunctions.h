@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Entry points that are resolved into dispatch tables instead of going
+// through the loader's trampolines. Only vkGetInstanceProcAddr and the
+// functions needed to create the instance are called through the loader.
+
+#define LV_INSTANCE_FUNCTIONS(X)                        \
+    X(vkDestroyInstance)                                \
+    X(vkEnumeratePhysicalDevices)                       \
+    X(vkEnumerateDeviceExtensionProperties)             \
+    X(vkGetPhysicalDeviceProperties)                    \
+    X(vkGetPhysicalDeviceProperties2)                   \
+    X(vkGetPhysicalDeviceFeatures2)                     \
+    X(vkGetPhysicalDeviceQueueFamilyProperties)         \
+    X(vkGetPhysicalDeviceMemoryProperties)              \
+    X(vkGetPhysicalDeviceMemoryProperties2)             \
+    X(vkGetPhysicalDeviceFormatProperties)              \
+    X(vkGetPhysicalDeviceImageFormatProperties2)        \
+    X(vkCreateDevice)                                   \
+    X(vkGetDeviceProcAddr)                              \
+    X(vkDestroySurfaceKHR)                              \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR)             \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR)        \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR)             \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR)
+
+// null when the extension isn't enabled
+#define LV_INSTANCE_EXTENSION_FUNCTIONS(X)              \
+    X(vkCreateDebugUtilsMessengerEXT)                   \
+    X(vkDestroyDebugUtilsMessengerEXT)
+
+#define LV_DEVICE_FUNCTIONS(X)                          \
+    X(vkDestroyDevice)                                  \
+    X(vkGetDeviceQueue)                                 \
+    X(vkDeviceWaitIdle)                                 \
+    X(vkQueueSubmit)                                    \
+    X(vkQueueWaitIdle)                                  \
+    X(vkCreateSwapchainKHR)                             \
+    X(vkDestroySwapchainKHR)                            \
+    X(vkGetSwapchainImagesKHR)                          \
+    X(vkAcquireNextImageKHR)                            \
+    X(vkQueuePresentKHR)                                \
+    X(vkCreateSemaphore)                                \
+    X(vkDestroySemaphore)                               \
+    X(vkCreateFence)                                    \
+    X(vkDestroyFence)                                   \
+    X(vkWaitForFences)                                  \
+    X(vkResetFences)                                    \
+    X(vkCreateCommandPool)                              \
+    X(vkDestroyCommandPool)                             \
+    X(vkResetCommandPool)                               \
+    X(vkAllocateCommandBuffers)                         \
+    X(vkFreeCommandBuffers)                             \
+    X(vkBeginCommandBuffer)                             \
+    X(vkEndCommandBuffer)                               \
+    X(vkResetCommandBuffer)                             \
+    X(vkAllocateMemory)                                 \
+    X(vkFreeMemory)                                     \
+    X(vkMapMemory)                                      \
+    X(vkUnmapMemory)                                    \
+    X(vkCreateBuffer)                                   \
+    X(vkDestroyBuffer)                                  \
+    X(vkGetBufferMemoryRequirements)                    \
+    X(vkBindBufferMemory)                               \
+    X(vkCreateImage)                                    \
+    X(vkDestroyImage)                                   \
+    X(vkGetImageMemoryRequirements)                     \
+    X(vkBindImageMemory)                                \
+    X(vkCreateImageView)                                \
+    X(vkDestroyImageView)                               \
+    X(vkCreateSampler)                                  \
+    X(vkDestroySampler)                                 \
+    X(vkCreateShaderModule)                             \
+    X(vkDestroyShaderModule)                            \
+    X(vkCreatePipelineCache)                            \
+    X(vkDestroyPipelineCache)                           \
+    X(vkGetPipelineCacheData)                           \
+    X(vkCreateGraphicsPipelines)                        \
+    X(vkCreateComputePipelines)                         \
+    X(vkDestroyPipeline)                                \
+    X(vkCreatePipelineLayout)                           \
+    X(vkDestroyPipelineLayout)                          \
+    X(vkCreateDescriptorSetLayout)                      \
+    X(vkDestroyDescriptorSetLayout)                     \
+    X(vkCreateDescriptorPool)                           \
+    X(vkDestroyDescriptorPool)                          \
+    X(vkAllocateDescriptorSets)                         \
+    X(vkUpdateDescriptorSets)                           \
+    X(vkCreateRenderPass)                               \
+    X(vkDestroyRenderPass)                              \
+    X(vkCreateFramebuffer)                              \
+    X(vkDestroyFramebuffer)                             \
+    X(vkCreateQueryPool)                                \
+    X(vkDestroyQueryPool)                               \
+    X(vkGetQueryPoolResults)                            \
+    X(vkCmdBeginRenderPass)                             \
+    X(vkCmdEndRenderPass)                               \
+    X(vkCmdBindPipeline)                                \
+    X(vkCmdBindDescriptorSets)                          \
+    X(vkCmdBindVertexBuffers)                           \
+    X(vkCmdBindIndexBuffer)                             \
+    X(vkCmdPushConstants)                               \
+    X(vkCmdSetViewport)                                 \
+    X(vkCmdSetScissor)                                  \
+    X(vkCmdDraw)                                        \
+    X(vkCmdDrawIndexed)                                 \
+    X(vkCmdDispatch)                                    \
+    X(vkCmdCopyBuffer)                                  \
+    X(vkCmdCopyBufferToImage)                           \
+    X(vkCmdPipelineBarrier)                             \
+    X(vkCmdResetQueryPool)                              \
+    X(vkCmdWriteTimestamp)
+
+// core functions that are loaded under their extension's name when the
+// api version is below the one they were promoted in
+#define LV_DEVICE_PROMOTED_FUNCTIONS(X)                                 \
+    X(vkWaitSemaphores, vkWaitSemaphoresKHR, VK_API_VERSION_1_2)        \
+    X(vkGetSemaphoreCounterValue, vkGetSemaphoreCounterValueKHR,        \
+      VK_API_VERSION_1_2)
+
+// null when the extension isn't enabled
+#define LV_DEVICE_EXTENSION_FUNCTIONS(X)                \
+    X(vkWaitForPresentKHR)                              \
+    X(vkCopyMemoryToImageEXT)                           \
+    X(vkTransitionImageLayoutEXT)
+
+namespace LearningVulkan
+{
+    struct InstanceDispatch
+    {
+#define LV_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+        LV_INSTANCE_FUNCTIONS(LV_DECLARE_FUNCTION)
+        LV_INSTANCE_EXTENSION_FUNCTIONS(LV_DECLARE_FUNCTION)
+#undef LV_DECLARE_FUNCTION
+
+        void Load(VkInstance instance);
+    };
+
+    // Resolved through vkGetDeviceProcAddr, so calls go straight to the
+    // driver without the loader looking up the device's dispatch
+    struct DeviceDispatch
+    {
+#define LV_DECLARE_FUNCTION(name, ...) PFN_##name name = nullptr;
+        LV_DEVICE_FUNCTIONS(LV_DECLARE_FUNCTION)
+        LV_DEVICE_PROMOTED_FUNCTIONS(LV_DECLARE_FUNCTION)
+        LV_DEVICE_EXTENSION_FUNCTIONS(LV_DECLARE_FUNCTION)
+#undef LV_DECLARE_FUNCTION
+
+        void Load(VkDevice device, const InstanceDispatch& instance,
+                  uint32_t apiVersion);
+    };
+}